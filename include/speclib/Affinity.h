@@ -0,0 +1,309 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     Affinity.h
+/// \brief    Placement of the threads that run the speculative loops on the CPUs of the machine
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#ifndef __AFFINITY_H
+#define __AFFINITY_H
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <utility>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace SpecLib {
+
+/// Policy to place the threads of a speculative loop
+enum class Affinity {
+  None,    ///< The threads are not pinned
+  Compact, ///< Consecutive threads on cores of the same socket
+  Scatter, ///< Consecutive threads on different sockets
+  List     ///< Threads pinned in order to the CPUs of Configuration::cpu_list_
+};
+
+namespace internal {
+
+/// Logical CPU and its position in the topology of the machine
+struct CpuInfo_t {
+  int cpu;       ///< Id of the logical CPU
+  int package;   ///< Socket of the CPU
+  int core;      ///< Physical core of the CPU
+  int core_rank; ///< Position of the core among those of its socket
+  int smt;       ///< Position of the CPU among the hardware threads of its core
+};
+
+/// Reads a value of the topology of \c cpu from sysfs. Returns -1 if it is not available
+inline int read_cpu_topology(const int cpu, const char * const name)
+{ int value = -1;
+
+  std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+  f >> value;
+  return f ? value : -1;
+}
+
+/// Logical CPUs the process can run on, ordered to place consecutive threads according to \c policy
+/** A CPU of every physical core is listed before any of their hardware siblings, so that
+    while there are enough cores each thread, in particular the one that runs the sequential
+    part of a chunk, has a physical core of its own */
+inline std::vector<int> build_cpu_order(const Affinity policy)
+{ std::vector<int> order;
+
+#ifdef __linux__
+  cpu_set_t mask;
+  if ((policy == Affinity::None) || (policy == Affinity::List) || sched_getaffinity(0, sizeof(mask), &mask)) {
+    return order;
+  }
+
+  std::vector<CpuInfo_t> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &mask)) {
+      const int package = read_cpu_topology(cpu, "physical_package_id");
+      const int core = read_cpu_topology(cpu, "core_id");
+      cpus.push_back({cpu, std::max(package, 0), (core < 0) ? cpu : core, 0, 0});
+    }
+  }
+
+  std::sort(cpus.begin(), cpus.end(), [](const CpuInfo_t& a, const CpuInfo_t& b) {
+    return (a.package != b.package) ? (a.package < b.package) : ((a.core != b.core) ? (a.core < b.core) : (a.cpu < b.cpu));
+  });
+  for (size_t i = 1; i < cpus.size(); i++) {
+    const CpuInfo_t& prev = cpus[i - 1];
+    if (cpus[i].package != prev.package) {
+      continue;
+    }
+    if (cpus[i].core == prev.core) {
+      cpus[i].core_rank = prev.core_rank;
+      cpus[i].smt = prev.smt + 1;
+    } else {
+      cpus[i].core_rank = prev.core_rank + 1;
+    }
+  }
+
+  if (policy == Affinity::Compact) {
+    std::stable_sort(cpus.begin(), cpus.end(), [](const CpuInfo_t& a, const CpuInfo_t& b) {
+      return (a.smt != b.smt) ? (a.smt < b.smt) : ((a.package != b.package) ? (a.package < b.package) : (a.core_rank < b.core_rank));
+    });
+  } else {
+    std::stable_sort(cpus.begin(), cpus.end(), [](const CpuInfo_t& a, const CpuInfo_t& b) {
+      return (a.smt != b.smt) ? (a.smt < b.smt) : ((a.core_rank != b.core_rank) ? (a.core_rank < b.core_rank) : (a.package < b.package));
+    });
+  }
+
+  for (const CpuInfo_t& info : cpus) {
+    order.push_back(info.cpu);
+  }
+#else
+  static_cast<void>(policy);
+#endif
+  return order;
+}
+
+/// Order of the logical CPUs for \c policy. The topology is only read once per policy
+inline const std::vector<int>& cpu_order(const Affinity policy)
+{ static const std::vector<int> compact_order = build_cpu_order(Affinity::Compact);
+  static const std::vector<int> scatter_order = build_cpu_order(Affinity::Scatter);
+  static const std::vector<int> no_order;
+
+  switch (policy) {
+    case Affinity::Compact:
+      return compact_order;
+    case Affinity::Scatter:
+      return scatter_order;
+    default:
+      return no_order;
+  }
+}
+
+/// Whether \c a and \c b are hardware threads of the same physical core. The topology is only read once
+inline bool same_core(const int a, const int b)
+{ static const std::vector<std::pair<int, int>> cores = [] { // (package, core) of each CPU, (-1, -1) if unknown
+    std::vector<std::pair<int, int>> v;
+#ifdef __linux__
+    cpu_set_t mask;
+    if (!sched_getaffinity(0, sizeof(mask), &mask)) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &mask)) {
+          v.resize(static_cast<size_t>(cpu) + 1, std::make_pair(-1, -1));
+          v[static_cast<size_t>(cpu)] = std::make_pair(std::max(read_cpu_topology(cpu, "physical_package_id"), 0), read_cpu_topology(cpu, "core_id"));
+        }
+      }
+    }
+#endif
+    return v;
+  }();
+
+  if (a == b) {
+    return true;
+  }
+  if ((a < 0) || (b < 0) || (static_cast<size_t>(std::max(a, b)) >= cores.size())) {
+    return false;
+  }
+  const std::pair<int, int>& core_a = cores[static_cast<size_t>(a)];
+  return (core_a.second >= 0) && (core_a == cores[static_cast<size_t>(b)]);
+}
+
+/// Number of NUMA nodes of the machine, 1 if it is not known. It is only read once
+inline int numa_nodes()
+{ static const int nodes = [] {
+    int n = 0;
+    while (std::ifstream("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist")) {
+      n++;
+    }
+    return std::max(n, 1);
+  }();
+
+  return nodes;
+}
+
+/// NUMA node of the CPU the calling thread runs on, -1 if it is not known
+inline int current_numa_node() noexcept
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu, node;
+  if (!syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+    return static_cast<int>(node);
+  }
+#endif
+  return -1;
+}
+
+/// \brief Provides to LinkedListPool whole pages placed on the NUMA node of the thread that requests them
+/// \internal The pools of the chunks grow in the thread that fills them, so their values are local to it.
+///           The placement is only a preference, so that it never fails, and it is skipped in single-node machines
+struct NodeLocalAllocator_t
+{
+  typedef std::size_t size_type; //!< Unsigned integral type that can represent the size of the largest object to be allocated.
+  typedef std::ptrdiff_t difference_type; //!< Signed integral type that can represent the difference of any two pointers.
+
+  /// Allocate nbytes bytes of space in the heap, moving them to the node of the calling thread
+  static char * malloc(const size_type nbytes)
+  {
+#ifdef __linux__
+    const size_type page = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+    const size_type size = (nbytes + page - 1) / page * page;
+    void *p;
+    if (posix_memalign(&p, page, size)) {
+      return nullptr;
+    }
+#ifdef SYS_mbind
+    const int node = current_numa_node();
+    if ((numa_nodes() > 1) && (node >= 0) && (node < 64)) {
+      const unsigned long mask = 1ul << node;
+      // MPOL_PREFERRED (1) with MPOL_MF_MOVE (2), so that pages reused from previous allocations also move
+      syscall(SYS_mbind, p, size, 1, &mask, sizeof(mask) * 8 + 1, 2);
+    }
+#endif
+    return static_cast<char *>(p);
+#else
+    return static_cast<char *>(std::malloc(nbytes));
+#endif
+  }
+
+  /// Deallocate the heap space pointed by block
+  static void free(char * const block)
+  { std::free(block); }
+
+};
+
+/// Whether a loop has its threads placed according to the topology of the machine. As all the loops
+///would use the same first CPUs of the order, only one of them at a time is placed this way
+inline std::atomic<bool>& topology_placement_busy()
+{ static std::atomic<bool> busy{false};
+  return busy;
+}
+
+/// Holds, during its lifetime, the placement according to the topology of the machine if no other loop holds it
+class TopologyPlacementGuard_t {
+
+  const bool held_;
+
+public:
+
+  /// Takes the placement if \c wanted and it is available
+  explicit TopologyPlacementGuard_t(const bool wanted) noexcept :
+  held_{wanted && !topology_placement_busy().exchange(true)}
+  { }
+
+  TopologyPlacementGuard_t(const TopologyPlacementGuard_t&) = delete;
+  TopologyPlacementGuard_t& operator=(const TopologyPlacementGuard_t&) = delete;
+
+  ~TopologyPlacementGuard_t()
+  {
+    if (held_) {
+      topology_placement_busy().store(false);
+    }
+  }
+
+  bool held() const noexcept { return held_; }
+
+};
+
+/// Pins the calling thread to a CPU during its lifetime, restoring the previous affinity afterwards
+class AffinityGuard_t {
+
+#ifdef __linux__
+  cpu_set_t prev_mask_;
+  bool pinned_;
+#endif
+
+public:
+
+  /// Pins the thread to \c cpu. A negative value leaves the thread unpinned
+  explicit AffinityGuard_t(const int cpu) noexcept
+#ifdef __linux__
+  : pinned_{false}
+  {
+    if ((cpu >= 0) && (cpu < CPU_SETSIZE) && !pthread_getaffinity_np(pthread_self(), sizeof(prev_mask_), &prev_mask_)) {
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      CPU_SET(cpu, &mask);
+      pinned_ = !pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    }
+  }
+#else
+  {
+    static_cast<void>(cpu);
+  }
+#endif
+
+  AffinityGuard_t(const AffinityGuard_t&) = delete;
+  AffinityGuard_t& operator=(const AffinityGuard_t&) = delete;
+
+  ~AffinityGuard_t()
+  {
+#ifdef __linux__
+    if (pinned_) {
+      pthread_setaffinity_np(pthread_self(), sizeof(prev_mask_), &prev_mask_);
+    }
+#endif
+  }
+
+};
+
+} // namespace internal
+
+} // namespace SpecLib
+
+#endif // __AFFINITY_H
@@ -39,7 +39,8 @@ struct PoolAllocator_malloc_free
 
 /// \brief Pool implemented by means of a linked list with atomic operations
 /// \tparam T type of the objects of the pool. They must have a field <tt>T * next</tt>
-template <typename T>
+/// \tparam Allocator provider of the space for the objects, with the API of PoolAllocator_malloc_free
+template <typename T, typename Allocator = PoolAllocator_malloc_free>
 class LinkedListPool {
   
   typedef std::vector<T *> vector_t;
@@ -47,12 +48,13 @@ class LinkedListPool {
   vector_t v_;            ///< Stores all the chunks allocated by this pool
   const int chunkSize_;   ///< How many holders to allocate each time
   const int minTSize_;    ///< Space allocated for each object
+  const bool keep_constructed_; ///< The objects are constructed once and kept alive while they are in the pool
   std::atomic<T *> head_; ///< Current head of the pool
   std::atomic_flag pool_mutex_; ///< mutex for global critical sections in the pool (only in allocate)
   
   /// Allocate a new chunk of chunkSize_ elements for the pool
   void allocate() {
-    char * baseptr = PoolAllocator_malloc_free::malloc(static_cast<size_t>(chunkSize_ * minTSize_));
+    char * baseptr = Allocator::malloc(static_cast<size_t>(chunkSize_ * minTSize_));
     char * const endptr = baseptr +  minTSize_ * (chunkSize_ - 1);
     T * const h = reinterpret_cast<T *>(baseptr);
     T * const q = reinterpret_cast<T *>(endptr);
@@ -68,7 +70,12 @@ class LinkedListPool {
     
     v_.push_back(h);
 
-    freeLinkedList(h, q);
+    if (keep_constructed_) {
+      q->next = head_.load(std::memory_order_relaxed);
+      while(!head_.compare_exchange_weak(q->next, h));
+    } else {
+      freeLinkedList(h, q);
+    }
     
     pool_mutex_.clear(std::memory_order_release);
   }
@@ -78,25 +85,35 @@ public:
   /// \brief Constructor
   /// \param chunkSize  number of elements to allocate at once in chunk when the pool is empty
   /// \param min_t_size minimum space to allocate for each item.
-  LinkedListPool(int chunkSize = 1, int min_t_size = static_cast<int>(sizeof(T))) :
+  /// \param keep_constructed if true, the items are only constructed when the pool grows and destroyed
+  ///                         with the pool, so they must be obtained with malloc() and returned with shallow_free().
+  ///                         This preserves the resources they hold, such as buffers, while they are in the pool
+  LinkedListPool(int chunkSize = 1, int min_t_size = static_cast<int>(sizeof(T)), const bool keep_constructed = false) :
   chunkSize_{(chunkSize < 1) ? 1 : chunkSize},
   minTSize_{(static_cast<int>(sizeof(T)) > min_t_size) ? static_cast<int>(sizeof(T)) : min_t_size},
+  keep_constructed_{keep_constructed},
   head_{nullptr}
 #if __cplusplus < 202002L
   // 'ATOMIC_FLAG_INIT' macro is no longer needed and deprecated since C++20, since default constructor of std::atomic_flag initializes it to clear state
   ,pool_mutex_{ATOMIC_FLAG_INIT}
 #endif
-  {
-    allocate();
-  }
+  { } // the first chunk is allocated on demand by malloc(), so unused pools cost no allocation
 
   /// \brief Destructor
-  /// \internal Since every \p free invokes the object's destructor, it is not called here
+  /// \internal Since every \p free invokes the object's destructor, it is not called here,
+  ///           unless the objects are kept constructed
   ~LinkedListPool()
   {
     typename vector_t::const_iterator const itend = v_.end();
-    for(typename vector_t::const_iterator it = v_.begin(); it != itend; ++it)
-      PoolAllocator_malloc_free::free(reinterpret_cast<char*>(*it));
+    for(typename vector_t::const_iterator it = v_.begin(); it != itend; ++it) {
+      if (keep_constructed_) {
+        char * p = reinterpret_cast<char*>(*it);
+        for (int i = 0; i < chunkSize_; i++, p += minTSize_) {
+          reinterpret_cast<T *>(p)->~T();
+        }
+      }
+      Allocator::free(reinterpret_cast<char*>(*it));
+    }
   }
 
   /// Return an item to the pool. Does not invoke destructor
@@ -21,57 +21,295 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <functional>
-#include <stdexcept>
-#include <mutex>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace SpecLib {
 
-template<typename T, const size_t NUM_VARS = 2048>
+/// \name Reduction operators
+/// Stateless operators for ReductionVar<T, Op>, which can be inlined in the reduction
+///@{
+struct Sum {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return a + b; }
+};
+
+struct Prod {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return a * b; }
+};
+
+struct Min {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return (b < a) ? b : a; }
+};
+
+struct Max {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return (a < b) ? b : a; }
+};
+
+struct BitAnd {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return a & b; }
+};
+
+struct BitOr {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return a | b; }
+};
+
+struct BitXor {
+  template<typename T>
+  constexpr T operator()(const T& a, const T& b) const { return a ^ b; }
+};
+
+/// Applies the stateless reduction operator \p Op element by element on arrays or vectors of the same size
+template<typename Op>
+struct ElementWise {
+
+  template<typename C>
+  C operator()(const C& a, const C& b) const {
+    C ret(a);
+    fold(ret, b);
+    return ret;
+  }
+
+  /// Folds \p b into \p acc in place, in a loop simple enough to be vectorized by the compiler
+  template<typename C>
+  void fold(C& acc, const C& b) const {
+    assert(acc.size() == b.size());
+    const Op op{};
+    const size_t n = acc.size();
+    auto * const pacc = acc.data();
+    const auto * const pb = b.data();
+    for (size_t i = 0; i < n; i++) {
+      pacc[i] = op(pacc[i], pb[i]);
+    }
+  }
+};
+///@}
+
+namespace internal {
+
+/// Whether the reduction operator \p Op can fold a value of type \p T into another one in place
+template<typename Op, typename T, typename = void>
+struct HasFold : std::false_type {};
+
+template<typename Op, typename T>
+struct HasFold<Op, T, decltype(static_cast<void>(std::declval<const Op&>().fold(std::declval<T&>(), std::declval<const T&>())))> : std::true_type {};
+
+}
+
+/// Variable for reductions in which each thread accumulates a partial result of its own
+/** Each thread accumulates its partial result in ::thread_val() and publishes it with
+    ::reduce(), which pushes it without locks to a list of pending partial results.
+    ::collect() folds the list into the result once all the threads have published theirs,
+    which in the speculative loops is done by the last thread that finishes its part.
+    \tparam Op type of the reduction operator. By default any callable is accepted at runtime,
+            while operators such as ::Sum or stateless lambdas (since C++20) avoid the type erasure */
+template<typename T, typename Op = std::function<T(const T&, const T&)>>
 class ReductionVar {
 
-  static thread_local std::array<T, NUM_VARS> comm_vals_;
+  static constexpr size_t NoSlot = std::numeric_limits<size_t>::max();
+  static constexpr size_t SlotsPerBlock = 32;
+
+  /// Storage of a thread for a variable, in a cache line of its own
+  struct alignas(64) Slot_t {
+    T value_;             ///< Partial result being accumulated by the thread
+    T partial_;           ///< Partial result published by the thread
+    std::uint64_t stamp_; ///< Stamp of the variable in whose pending list the partial result is, 0 if none
+    Slot_t *next_;        ///< Next partial result in the pending list
+
+    Slot_t() :
+    value_{},
+    partial_{},
+    stamp_{0},
+    next_{nullptr}
+    { }
+  };
+
+  typedef std::array<Slot_t, SlotsPerBlock> SlotBlock_t;
+
+  /// Destroys and frees the blocks built by ::new_block
+  struct SlotBlockDeleter_t {
+    void operator()(SlotBlock_t * const block) const noexcept
+    {
+      void * const raw = reinterpret_cast<void **>(block)[-1];
+      block->~SlotBlock_t();
+      ::operator delete(raw);
+    }
+  };
+
+  typedef std::unique_ptr<SlotBlock_t, SlotBlockDeleter_t> SlotBlockPtr_t;
 
-  struct CommonValue_t {
-    std::atomic<char> state_;
-    CommonValue_t() :
-    state_{0}
+  /// Builds a block with the alignment of its slots, which plain \c new only guarantees since C++17
+  /** The pointer to the storage actually allocated is kept right before the block */
+  static SlotBlockPtr_t new_block()
+  {
+    static_assert(alignof(SlotBlock_t) >= sizeof(void *), "No room for the pointer to the storage");
+    void * const raw = ::operator new(sizeof(SlotBlock_t) + alignof(SlotBlock_t));
+    const std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + alignof(SlotBlock_t)) & ~static_cast<std::uintptr_t>(alignof(SlotBlock_t) - 1);
+    void ** const p = reinterpret_cast<void **>(aligned);
+    p[-1] = raw;
+    try {
+      return SlotBlockPtr_t(::new (static_cast<void *>(p)) SlotBlock_t());
+    } catch (...) {
+      ::operator delete(raw);
+      throw;
+    }
+  }
+
+  /// Hands out the identifiers of the slots of the variables in constant time, reusing the released ones
+  class SlotIds_t {
+    std::vector<size_t> released_;
+    size_t next_id_;
+    std::atomic_flag mutex_;
+
+    void lock() noexcept { while (mutex_.test_and_set(std::memory_order_acquire)); }
+    void unlock() noexcept { mutex_.clear(std::memory_order_release); }
+
+  public:
+
+    SlotIds_t() :
+    next_id_{0}
+#if __cplusplus < 202002L
+    ,mutex_{ATOMIC_FLAG_INIT}
+#endif
     { }
+
+    size_t acquire()
+    {
+      lock();
+      size_t id;
+      if (released_.empty()) {
+        try {
+          released_.reserve(next_id_ + 1); // so that ::release never needs to allocate
+        } catch (...) {
+          unlock();
+          throw;
+        }
+        id = next_id_++;
+      } else {
+        id = released_.back();
+        released_.pop_back();
+      }
+      unlock();
+      return id;
+    }
+
+    void release(const size_t id) noexcept
+    {
+      lock();
+      released_.push_back(id);
+      unlock();
+    }
   };
-  static std::array<CommonValue_t, NUM_VARS>& getCommonStorage() {
-    static std::array<CommonValue_t, NUM_VARS> CommonStorage{};
-    return CommonStorage;
+
+  /// Never destroyed, as variables with static storage built after its first use may still release their slots
+  static SlotIds_t& slot_ids() {
+    static SlotIds_t * const SlotIds = new SlotIds_t();
+    return *SlotIds;
+  }
+
+  /// Blocks of slots of the calling thread, allocated on demand
+  static std::vector<SlotBlockPtr_t>& thread_blocks() {
+    static thread_local std::vector<SlotBlockPtr_t> Blocks;
+    return Blocks;
   }
 
-  static size_t startFindStorageId;  // not thread-safe but its only a hint from where start the find process
+  static Slot_t& new_thread_slot(const size_t id) {
+    auto& blocks = thread_blocks();
+    const size_t nblock = id / SlotsPerBlock;
+    if (nblock >= blocks.size()) {
+      blocks.resize(nblock + 1);
+    }
+    if (!blocks[nblock]) {
+      blocks[nblock] = new_block();
+    }
+    return (*blocks[nblock])[id % SlotsPerBlock];
+  }
+
+  /// Slot of the calling thread for the variable with identifier \p id
+  static Slot_t& thread_slot(const size_t id) {
+    auto& blocks = thread_blocks();
+    const size_t nblock = id / SlotsPerBlock;
+    if ((nblock < blocks.size()) && blocks[nblock]) {
+      return (*blocks[nblock])[id % SlotsPerBlock];
+    }
+    return new_thread_slot(id);
+  }
 
   T identity_;
-  std::function<T(const T&, const T&)> reduction_function_;
+  std::remove_cv_t<Op> reduction_function_;
   T common_value_;
   size_t storageId_;
-  std::mutex red_mtx;
-
-  static size_t FindAvailableVar() {
-      auto& CommonStorage = getCommonStorage();
-      const size_t localStartFindStorageId = startFindStorageId;
-      size_t i = localStartFindStorageId;
-      do {
-      if (!CommonStorage[i].state_.load(std::memory_order_relaxed)) {
-        char tmp = 0;
-        if (CommonStorage[i].state_.compare_exchange_strong(tmp, 1)) {
-          startFindStorageId = ((i + 1) < NUM_VARS) ? (i + 1) : 0;
-          return i;
-        }
-      }
-      i = ((i + 1) < NUM_VARS) ? (i + 1) : 0;
-    }while(i != localStartFindStorageId);
-    throw std::runtime_error("Unable to allocate ReductionVar");
+  std::uint64_t stamp_;                 ///< Identifies the current list of pending partial results of the variable
+  std::atomic<Slot_t *> pending_;       ///< Partial results published and not collected yet
+
+  static std::uint64_t new_stamp() noexcept
+  {
+    static std::atomic<std::uint64_t> last_stamp{0};
+    return last_stamp.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /// Folds \p v into \p acc, in place when the operator supports it
+  void fold(T& acc, const T& v) const
+  {
+    fold(acc, v, internal::HasFold<std::remove_cv_t<Op>, T>{});
+  }
+
+  void fold(T& acc, const T& v, std::true_type) const
+  {
+    reduction_function_.fold(acc, v);
+  }
+
+  void fold(T& acc, const T& v, std::false_type) const
+  {
+    acc = reduction_function_(acc, v);
+  }
+
+  void assign_function(const Op& f)
+  {
+    assign_function(f, std::is_copy_assignable<std::remove_cv_t<Op>>{});
+  }
+
+  void assign_function(const Op& f, std::true_type)
+  {
+    reduction_function_ = f;
+  }
+
+  /// Operators that cannot be assigned, such as lambdas, are kept as they are, which is only correct if they are stateless
+  void assign_function(const Op&, std::false_type) noexcept
+  {
+    static_assert(std::is_empty<Op>::value, "The reduction operator must be copy assignable or stateless");
+  }
+
+  /// Forgets the partial results not collected
+  void drop_pending() noexcept
+  {
+    pending_.store(nullptr, std::memory_order_relaxed);
+    stamp_ = new_stamp();
   }
 
 public:
 
   ReductionVar() noexcept :
-  storageId_{NUM_VARS}
+  storageId_{NoSlot},
+  stamp_{new_stamp()},
+  pending_{nullptr}
+  { }
+
+  /// Builds a variable whose operator is default constructed, as in ReductionVar<int, Sum>
+  template<typename O = Op, typename = std::enable_if_t<std::is_empty<O>::value && std::is_default_constructible<O>::value>>
+  explicit ReductionVar(const T identity) :
+  ReductionVar(identity, std::remove_cv_t<Op>{})
   { }
 
   template<typename F>
@@ -79,9 +317,11 @@ public:
   identity_{identity},
   reduction_function_{reduction_function},
   common_value_{identity},
-  storageId_{FindAvailableVar()}
+  storageId_{slot_ids().acquire()},
+  stamp_{new_stamp()},
+  pending_{nullptr}
   {
-    comm_vals_[storageId_] = identity;
+    thread_slot(storageId_).value_ = identity;
   }
 
   template<typename F>
@@ -89,9 +329,11 @@ public:
   identity_{identity},
   reduction_function_{reduction_function},
   common_value_{init_value},
-  storageId_{FindAvailableVar()}
+  storageId_{slot_ids().acquire()},
+  stamp_{new_stamp()},
+  pending_{nullptr}
   {
-    comm_vals_[storageId_] = identity;
+    thread_slot(storageId_).value_ = identity;
   }
 
   ~ReductionVar() {
@@ -102,10 +344,12 @@ public:
   identity_{other.identity_},
   reduction_function_{other.reduction_function_},
   common_value_{other.common_value_},
-  storageId_{other.empty() ? NUM_VARS : FindAvailableVar()}
+  storageId_{other.empty() ? NoSlot : slot_ids().acquire()},
+  stamp_{new_stamp()},
+  pending_{nullptr}
   {
     if (!empty()) {
-      comm_vals_[storageId_] = other.comm_vals_[other.storageId_];
+      thread_slot(storageId_).value_ = thread_slot(other.storageId_).value_;
     }
   }
 
@@ -113,32 +357,39 @@ public:
   identity_{other.identity_},
   reduction_function_{other.reduction_function_},
   common_value_{other.common_value_},
-  storageId_{other.storageId_}
+  storageId_{other.storageId_},
+  stamp_{other.stamp_},
+  pending_{other.pending_.load(std::memory_order_relaxed)}
   {
-    other.storageId_ = NUM_VARS;
+    other.storageId_ = NoSlot;
+    other.drop_pending();
   }
 
   ReductionVar& operator=(const ReductionVar& other) {       // Copy assignment
+    drop_pending();
     if (other.empty()) {
       free_storage();
-      storageId_ = NUM_VARS;
+      storageId_ = NoSlot;
     } else {
       if (empty()) {
-        storageId_ = FindAvailableVar();
+        storageId_ = slot_ids().acquire();
       }
       common_value_ = other.common_value_;
       identity_ = other.identity_;
-      reduction_function_ = other.reduction_function_;
+      assign_function(other.reduction_function_);
     }
     return *this;
   }
   ReductionVar& operator=(ReductionVar&& other) noexcept {   // Move assignment
     free_storage();
     storageId_ = other.storageId_;
-    other.storageId_ = NUM_VARS;
+    other.storageId_ = NoSlot;
+    stamp_ = other.stamp_;
+    pending_.store(other.pending_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    other.drop_pending();
     common_value_ = other.common_value_;
     identity_ = other.identity_;
-    reduction_function_ = other.reduction_function_;
+    assign_function(other.reduction_function_);
     return *this;
   }
 
@@ -160,11 +411,11 @@ public:
     return !(*this == other);
   }
 
-  constexpr bool empty() const noexcept { return (storageId_ == NUM_VARS); }
+  constexpr bool empty() const noexcept { return (storageId_ == NoSlot); }
 
-  inline void initialize() noexcept {
+  inline void initialize() {
     assert(!empty());
-    comm_vals_[storageId_] = identity_;
+    thread_slot(storageId_).value_ = identity_;
   }
 
   inline void set(const T& new_val) noexcept {
@@ -174,15 +425,33 @@ public:
     common_value_ = std::forward<T>(new_val);
   }
 
+  /// Publishes the partial result of the calling thread, to be folded by ::collect
+  /** The partial result is kept in the storage of the thread, which must not finish before ::collect */
   inline void reduce() {
     assert(!empty());
-    std::lock_guard<std::mutex> lck(red_mtx);
-    common_value_ = reduction_function_(common_value_, comm_vals_[storageId_]);
+    Slot_t& slot = thread_slot(storageId_);
+    if (slot.stamp_ == stamp_) { // already in the pending list
+      fold(slot.partial_, slot.value_);
+    } else {
+      slot.partial_ = slot.value_;
+      slot.stamp_ = stamp_;
+      slot.next_ = pending_.load(std::memory_order_relaxed);
+      while (!pending_.compare_exchange_weak(slot.next_, &slot, std::memory_order_release, std::memory_order_relaxed));
+    }
+  }
+
+  /// Folds the partial results published into the result
+  /** Must not run concurrently with ::reduce or other accesses to the result of the variable */
+  inline void collect() {
+    for (Slot_t *p = pending_.exchange(nullptr, std::memory_order_acquire); p != nullptr; p = p->next_) {
+      fold(common_value_, p->partial_);
+      p->stamp_ = 0;
+    }
   }
 
-  constexpr T& thread_val() const noexcept {
+  T& thread_val() const {
     assert(!empty());
-    return comm_vals_[storageId_];
+    return thread_slot(storageId_).value_;
   };
 
   const constexpr T& identity() const noexcept {
@@ -203,17 +472,19 @@ public:
 
   void free_storage() noexcept {
     if (!empty()) {
-//    startFindStorageId = storageId_;
-      getCommonStorage()[storageId_].state_.store(0, std::memory_order_relaxed);
+      slot_ids().release(storageId_);
     }
   }
 };
 
-template<typename T, const size_t NUM_VARS>
-thread_local std::array<T, NUM_VARS> ReductionVar<T, NUM_VARS>::comm_vals_{};
+/// Reduction of the \p N elements of an array, as in histograms, merged element by element with \p Op
+template<typename T, size_t N, typename Op = Sum>
+using ReductionArray = ReductionVar<std::array<T, N>, ElementWise<Op>>;
 
-template<typename T, const size_t NUM_VARS>
-size_t ReductionVar<T, NUM_VARS>::startFindStorageId{};
+/// Reduction of the elements of a vector, as in histograms, merged element by element with \p Op.
+/// The size is that of the identity, which all the values must keep
+template<typename T, typename Op = Sum>
+using ReductionVector = ReductionVar<std::vector<T>, ElementWise<Op>>;
 
 }
 
@@ -0,0 +1,298 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     SpecCowVector.h
+/// \brief    Dense vector whose copies share its blocks until they are written
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#ifndef _SPECCOWVECTOR_H_
+#define _SPECCOWVECTOR_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace SpecLib {
+
+/// Vector whose copies are copy-on-write snapshots
+/** The elements are stored in blocks (of a page by default) that the copies of the vector
+    share. A block is only duplicated the first time an object that shares it writes it,
+    so copying the vector costs a pass over its table of blocks, and comparing two copies
+    only compares the blocks they do not share. This makes large arguments of which each
+    chunk only modifies a small part cheap to speculate on, since the runtime copies the
+    state of every chunk several times.
+
+    The non-const accesses through operator[] may duplicate their block, so reads should
+    use ::get() or a const reference. An object must not be written while it is copied,
+    which the runtime guarantees for the copies it makes of its arguments. */
+template <typename T>
+class SpecCowVector {
+
+  struct Block_t {
+    std::atomic<size_t> refs_;
+    std::uint64_t owner_;   ///< Stamp of the object that may write the block in place
+    std::vector<T> data_;
+
+    Block_t(const std::uint64_t owner, std::vector<T>&& data) :
+    refs_{1},
+    owner_{owner},
+    data_(std::move(data))
+    { }
+  };
+
+  size_t size_;
+  size_t block_;
+  size_t nblocks_;
+  std::unique_ptr<std::atomic<Block_t *>[]> table_;
+  mutable std::uint64_t stamp_;
+  std::mutex retired_mutex_;
+  std::vector<Block_t *> retired_; ///< Blocks replaced by the copies of their writers, which concurrent readers may still use
+
+  static std::uint64_t new_stamp() noexcept
+  {
+    static std::atomic<std::uint64_t> last_stamp{0};
+    return last_stamp.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  static constexpr size_t default_block() noexcept { return (sizeof(T) >= 4096) ? 1 : (4096 / sizeof(T)); }
+
+  static Block_t *retain(Block_t * const blk) noexcept
+  {
+    blk->refs_.fetch_add(1, std::memory_order_relaxed);
+    return blk;
+  }
+
+  static void release(Block_t * const blk) noexcept
+  {
+    if (blk->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete blk;
+    }
+  }
+
+  void release_retired() noexcept
+  {
+    for (Block_t * const blk : retired_) {
+      release(blk);
+    }
+    retired_.clear();
+  }
+
+  void release_all() noexcept
+  {
+    for (size_t b = 0; b < nblocks_; ++b) {
+      release(table_[b].load(std::memory_order_relaxed));
+    }
+    release_retired();
+    table_.reset();
+    size_ = nblocks_ = 0;
+  }
+
+  /// Builds the blocks from the range [\c first, \c last)
+  template<typename It>
+  void build(It first, const It last)
+  {
+    std::vector<T> all(first, last);
+    size_ = all.size();
+    nblocks_ = (size_ + block_ - 1) / block_;
+    table_.reset(nblocks_ ? new std::atomic<Block_t *>[nblocks_] : nullptr);
+    for (size_t b = 0; b < nblocks_; ++b) {
+      const auto bbegin = all.begin() + static_cast<std::ptrdiff_t>(b * block_);
+      const auto bend = all.begin() + static_cast<std::ptrdiff_t>(std::min(size_, (b + 1) * block_));
+      table_[b].store(new Block_t(stamp_, std::vector<T>(bbegin, bend)), std::memory_order_relaxed);
+    }
+  }
+
+  /// Shares the blocks of \c other, which must have the same geometry
+  void share(const SpecCowVector& other) noexcept
+  {
+    for (size_t b = 0; b < nblocks_; ++b) {
+      Block_t * const mine = table_[b].load(std::memory_order_relaxed);
+      Block_t * const theirs = other.table_[b].load(std::memory_order_acquire);
+      if (mine != theirs) {
+        table_[b].store(retain(theirs), std::memory_order_relaxed);
+        release(mine);
+      }
+    }
+  }
+
+  /// Block \c b, duplicated first if this object does not own it
+  Block_t *writable_block(const size_t b)
+  {
+    Block_t *blk = table_[b].load(std::memory_order_acquire);
+    if (blk->owner_ != stamp_) {
+      Block_t * const copy = new Block_t(stamp_, std::vector<T>(blk->data_));
+      if (table_[b].compare_exchange_strong(blk, copy, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        retired_.push_back(blk);
+        blk = copy;
+      } else { // another thread writing this object got the block first
+        delete copy;
+      }
+    }
+    return blk;
+  }
+
+public:
+
+  using value_type = T;
+
+  /// Vector of \c size copies of \c value stored in blocks of \c block elements (by default, a page)
+  explicit SpecCowVector(const size_t size = 0, const T& value = T(), const size_t block = default_block()) :
+  size_{0},
+  block_{std::max(block, static_cast<size_t>(1))},
+  nblocks_{0},
+  stamp_{new_stamp()}
+  {
+    const std::vector<T> all(size, value);
+    build(all.begin(), all.end());
+  }
+
+  SpecCowVector(const std::vector<T>& source, const size_t block = default_block()) :
+  SpecCowVector(0, T(), block)
+  {
+    build(source.begin(), source.end());
+  }
+
+  template<std::size_t N>
+  SpecCowVector(const std::array<T, N>& source, const size_t block = default_block()) :
+  SpecCowVector(0, T(), block)
+  {
+    build(source.begin(), source.end());
+  }
+
+  SpecCowVector(const SpecCowVector& other) :
+  size_{other.size_},
+  block_{other.block_},
+  nblocks_{other.nblocks_},
+  table_{nblocks_ ? new std::atomic<Block_t *>[nblocks_] : nullptr},
+  stamp_{new_stamp()}
+  {
+    for (size_t b = 0; b < nblocks_; ++b) {
+      table_[b].store(retain(other.table_[b].load(std::memory_order_acquire)), std::memory_order_relaxed);
+    }
+    other.stamp_ = new_stamp();
+  }
+
+  SpecCowVector(SpecCowVector&& other) noexcept :
+  size_{other.size_},
+  block_{other.block_},
+  nblocks_{other.nblocks_},
+  table_{std::move(other.table_)},
+  stamp_{other.stamp_},
+  retired_(std::move(other.retired_))
+  {
+    other.size_ = other.nblocks_ = 0;
+    other.stamp_ = new_stamp();
+  }
+
+  SpecCowVector& operator=(const SpecCowVector& other)
+  {
+    if (this != &other) {
+      release_retired();
+      if ((nblocks_ == other.nblocks_) && (size_ == other.size_) && (block_ == other.block_)) {
+        share(other);
+      } else {
+        SpecCowVector tmp(other);
+        *this = std::move(tmp);
+      }
+      other.stamp_ = new_stamp();
+    }
+    return *this;
+  }
+
+  SpecCowVector& operator=(SpecCowVector&& other) noexcept
+  {
+    if (this != &other) {
+      release_all();
+      size_ = other.size_;
+      block_ = other.block_;
+      nblocks_ = other.nblocks_;
+      table_ = std::move(other.table_);
+      stamp_ = other.stamp_;
+      retired_ = std::move(other.retired_);
+      other.size_ = other.nblocks_ = 0;
+      other.stamp_ = new_stamp();
+    }
+    return *this;
+  }
+
+  ~SpecCowVector()
+  {
+    release_all();
+  }
+
+  bool operator==(const SpecCowVector& other) const
+  {
+    if ((size_ != other.size_) || (block_ != other.block_)) {
+      return (size_ == other.size_) && (values() == other.values());
+    }
+    for (size_t b = 0; b < nblocks_; ++b) {
+      const Block_t * const mine = table_[b].load(std::memory_order_acquire);
+      const Block_t * const theirs = other.table_[b].load(std::memory_order_acquire);
+      if ((mine != theirs) && (mine->data_ != theirs->data_)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const SpecCowVector& other) const
+  {
+    return !(*this == other);
+  }
+
+  size_t size() const noexcept { return size_; }
+
+  /// Number of elements stored together
+  size_t block() const noexcept { return block_; }
+
+  /// Access for writing, which duplicates the block of the element if it is shared
+  T& operator[](const size_t i)
+  {
+    assert(i < size_);
+    return writable_block(i / block_)->data_[i % block_];
+  }
+
+  const T& operator[](const size_t i) const noexcept { return get(i); }
+
+  /// Access for reading, which never duplicates the block of the element
+  const T& get(const size_t i) const noexcept
+  {
+    assert(i < size_);
+    return table_[i / block_].load(std::memory_order_acquire)->data_[i % block_];
+  }
+
+  void set(const size_t i, const T& value) { (*this)[i] = value; }
+
+  /// Copy of the contents of the vector
+  std::vector<T> values() const
+  { std::vector<T> ret;
+
+    ret.reserve(size_);
+    for (size_t b = 0; b < nblocks_; ++b) {
+      const auto& data = table_[b].load(std::memory_order_acquire)->data_;
+      ret.insert(ret.end(), data.begin(), data.end());
+    }
+    return ret;
+  }
+
+};
+
+}
+
+#endif
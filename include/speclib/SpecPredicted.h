@@ -0,0 +1,178 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     SpecPredicted.h
+/// \brief    Variable whose value at the beginning of each speculative chunk is predicted from its history
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+
+#ifndef __SPECPREDICTED_H_
+#define __SPECPREDICTED_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace SpecLib {
+
+/// Values of a SpecPredicted at the last validated boundaries of the chunks of a speculative loop
+template<typename T, const size_t CAPACITY = 4>
+class PredictionHistory {
+
+public:
+
+  /// Value at the beginning of an iteration
+  struct Entry {
+    long long iteration;
+    T value;
+  };
+
+private:
+
+  std::array<Entry, CAPACITY> entries_;
+  size_t first_;
+  size_t size_;
+
+public:
+
+  PredictionHistory() noexcept :
+  first_{0},
+  size_{0}
+  { }
+
+  /// Number of known values, at most CAPACITY
+  size_t size() const noexcept { return size_; }
+
+  bool empty() const noexcept { return !size_; }
+
+  /// Entry \c i, where 0 is the most recent one
+  const Entry& operator[](const size_t i) const noexcept { return entries_[(first_ + i) % CAPACITY]; }
+
+  void clear() noexcept { size_ = 0; }
+
+  void push(const long long iteration, const T& value)
+  {
+    first_ = (first_ + CAPACITY - 1) % CAPACITY;
+    entries_[first_] = Entry{iteration, value};
+    if (size_ < CAPACITY) {
+      size_++;
+    }
+  }
+
+};
+
+/// Predicts the value at the last validated boundary
+/** Suitable for variables that rarely change */
+struct LastValuePredictor {
+  template<typename T, size_t CAPACITY>
+  T operator()(const PredictionHistory<T, CAPACITY>& history, const T& speculated, const long long) const
+  {
+    return history.empty() ? speculated : history[0].value;
+  }
+};
+
+/// Extrapolates linearly the change per iteration between the last two validated boundaries
+/** Suitable for counters and other variables that evolve with a constant stride */
+struct StridePredictor {
+  template<typename T, size_t CAPACITY>
+  T operator()(const PredictionHistory<T, CAPACITY>& history, const T& speculated, const long long iteration) const
+  {
+    if (history.size() < 2) {
+      return speculated;
+    }
+    const auto& last = history[0];
+    const auto& prev = history[1];
+    // The boundaries are monotonic, so the ratio of the distances is positive also for decreasing loops
+    return last.value + (last.value - prev.value) * static_cast<T>(std::llabs(iteration - last.iteration)) / static_cast<T>(std::llabs(last.iteration - prev.iteration));
+  }
+};
+
+/// Variable whose value at the beginning of each speculative chunk is given by a predictor
+/** By default the chunks start from the value that the parallel run of their predecessor
+    computed. A predictor replaces that value with one computed from the history of values
+    of the variable at the boundaries of the chunks already validated, such as LastValuePredictor,
+    StridePredictor or a user function with the same signature. The loop body accesses the value
+    through ::value(). As with any other variable, wrong predictions are detected by the
+    validation of the chunks and corrected by rerunning them */
+template<typename T, const size_t CAPACITY = 4>
+class SpecPredicted {
+
+public:
+
+  using value_type = T;
+  using History = PredictionHistory<T, CAPACITY>;
+  using Predictor = std::function<T(const History&, const T&, long long)>;
+
+private:
+
+  /// History and predictor shared by the copies of the variable used by the chunks
+  struct State_t {
+    Predictor predictor_;
+    History history_;
+    std::mutex mutex_;
+
+    State_t(const Predictor& predictor) :
+    predictor_{predictor}
+    { }
+  };
+
+  T value_;
+  std::shared_ptr<State_t> state_;
+
+public:
+
+  template<typename P = StridePredictor>
+  SpecPredicted(const T& value = T(), const P& predictor = P()) :
+  value_{value},
+  state_{std::make_shared<State_t>(predictor)}
+  { }
+
+  bool operator==(const SpecPredicted& other) const { return value_ == other.value_; }
+
+  bool operator!=(const SpecPredicted& other) const { return !(*this == other); }
+
+  T& value() noexcept { return value_; }
+
+  const T& value() const noexcept { return value_; }
+
+  void set(const T& new_val) { value_ = new_val; }
+
+  /// Forgets the history and records the value at the \c iteration where a loop begins
+  void start(const long long iteration)
+  {
+    std::lock_guard<std::mutex> lck(state_->mutex_);
+    state_->history_.clear();
+    state_->history_.push(iteration, value_);
+  }
+
+  /// Records the value, known to be correct, at the beginning of \c iteration
+  void record(const long long iteration)
+  {
+    std::lock_guard<std::mutex> lck(state_->mutex_);
+    state_->history_.push(iteration, value_);
+  }
+
+  /// Replaces the value speculated for the beginning of \c iteration with the prediction
+  void predict(const long long iteration)
+  {
+    std::lock_guard<std::mutex> lck(state_->mutex_);
+    value_ = state_->predictor_(state_->history_, value_, iteration);
+  }
+
+};
+
+}
+
+#endif
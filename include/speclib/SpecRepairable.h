@@ -0,0 +1,163 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     SpecRepairable.h
+/// \brief    Variable whose value in a chunk that started from a wrong speculated value can be repaired
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+
+#ifndef __SPECREPAIRABLE_H_
+#define __SPECREPAIRABLE_H_
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace SpecLib {
+
+/// Adds to the value the difference between the true and the speculated starts
+/** Suitable for sums and counters */
+struct AdditiveRepair {
+  template<typename T>
+  T operator()(const T& true_start, const T& spec_start, const T& spec_end) const
+  {
+    return spec_end + (true_start - spec_start);
+  }
+};
+
+/// Repairs running maximums, which is only possible if the speculated start was not above the true one
+struct MaxRepair {
+  template<typename T>
+  bool repairable(const T& true_start, const T& spec_start) const
+  {
+    return !(true_start < spec_start);
+  }
+
+  template<typename T>
+  T operator()(const T& true_start, const T&, const T& spec_end) const
+  {
+    return (spec_end < true_start) ? true_start : spec_end;
+  }
+};
+
+/// Repairs running minimums, which is only possible if the speculated start was not below the true one
+struct MinRepair {
+  template<typename T>
+  bool repairable(const T& true_start, const T& spec_start) const
+  {
+    return !(spec_start < true_start);
+  }
+
+  template<typename T>
+  T operator()(const T& true_start, const T&, const T& spec_end) const
+  {
+    return (true_start < spec_end) ? true_start : spec_end;
+  }
+};
+
+namespace internal {
+
+/// Whether the repair function \p R tells which pairs of starts of type \p T it can repair
+template<typename R, typename T, typename = void>
+struct HasRepairable : std::false_type {};
+
+template<typename R, typename T>
+struct HasRepairable<R, T, decltype(static_cast<void>(std::declval<const R&>().repairable(std::declval<const T&>(), std::declval<const T&>())))> : std::true_type {};
+
+}
+
+/// Variable whose value in a chunk that started from a wrong speculated value can be repaired
+/** When the value with which a chunk starts differs from the one that its predecessor actually
+    computed, the chunk is normally cancelled and rerun. If the only differences are in
+    SpecRepairables, the chunk is kept, and its validation replaces the value of each one with
+    <tt>repair(true_start, spec_start, spec_end)</tt>. The repair function may also provide
+    <tt>bool repairable(true_start, spec_start)</tt> to reject the starts it cannot repair, as
+    MaxRepair and MinRepair do, so that the chunk is rerun as usual. The loop body accesses the
+    value through ::value(), and the rest of its effects must not depend on it, as they are not repaired.
+    Values built without a repair function are not repaired, so their chunks are also rerun.
+    \tparam R type of the repair function. By default any callable is accepted at runtime */
+template<typename T, typename R = std::function<T(const T&, const T&, const T&)>>
+class SpecRepairable {
+
+public:
+
+  using value_type = T;
+
+private:
+
+  T value_;
+  std::remove_cv_t<R> repair_;
+
+  bool repairable(const T& true_start, const T& spec_start, std::true_type) const
+  {
+    return repair_.repairable(true_start, spec_start);
+  }
+
+  /// The repair function accepts any pair of starts
+  bool repairable(const T&, const T&, std::false_type) const noexcept
+  {
+    return true;
+  }
+
+  /// Whether a repair function was provided, as an empty \c std::function or null pointer cannot repair anything
+  bool has_repair(std::true_type) const noexcept
+  {
+    return static_cast<bool>(repair_);
+  }
+
+  /// The repair function cannot be empty
+  bool has_repair(std::false_type) const noexcept
+  {
+    return true;
+  }
+
+public:
+
+  SpecRepairable() :
+  value_{},
+  repair_{}
+  { }
+
+  template<typename R2 = std::remove_cv_t<R>>
+  SpecRepairable(const T& value, const R2& repair = R2()) :
+  value_{value},
+  repair_{repair}
+  { }
+
+  bool operator==(const SpecRepairable& other) const { return value_ == other.value_; }
+
+  bool operator!=(const SpecRepairable& other) const { return !(*this == other); }
+
+  T& value() noexcept { return value_; }
+
+  const T& value() const noexcept { return value_; }
+
+  void set(const T& new_val) { value_ = new_val; }
+
+  /// Whether a value computed from \c spec_start instead of \c true_start can be repaired
+  /** Values without a repair function, such as the default-constructed ones, are never repaired */
+  bool repairable(const T& true_start, const T& spec_start) const
+  {
+    return has_repair(std::is_constructible<bool, const std::remove_cv_t<R>&>{}) && repairable(true_start, spec_start, internal::HasRepairable<std::remove_cv_t<R>, T>{});
+  }
+
+  /// Replaces the value computed from \c spec_start with the one that \c true_start would have given
+  void repair(const T& true_start, const T& spec_start)
+  {
+    value_ = repair_(true_start, spec_start, value_);
+  }
+
+};
+
+}
+
+#endif
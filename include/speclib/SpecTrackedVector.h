@@ -0,0 +1,193 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     SpecTrackedVector.h
+/// \brief    Dense vector that tracks the blocks written, so that its copies and comparisons only visit those blocks
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#ifndef _SPECTRACKEDVECTOR_H_
+#define _SPECTRACKEDVECTOR_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace SpecLib {
+
+/// Vector whose copies and comparisons only visit the blocks written since they diverged
+/** Each block of elements carries the stamp of the last object that wrote it. Two objects
+    whose blocks have the same stamp are known to hold the same contents in them, so
+    assignments only copy, and comparisons only compare, the blocks with different stamps.
+    This makes large arguments of which each chunk only modifies a small part cheap to
+    speculate on, as the state is copied for every chunk and compared in every validation.
+
+    The non-const accesses through operator[] mark their block as written, so reads that
+    should not count as writes should use ::get() or a const reference. An object that is
+    copied moves to a new stamp, so that its later writes are distinguished from the
+    contents shared with the copy. */
+template <typename T>
+class SpecTrackedVector {
+
+  std::vector<T> data_;
+  std::vector<std::uint64_t> stamps_;
+  size_t block_;
+  mutable std::uint64_t stamp_;
+
+  static std::uint64_t new_stamp() noexcept
+  {
+    static std::atomic<std::uint64_t> last_stamp{0};
+    return last_stamp.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  static constexpr size_t default_block() noexcept { return (sizeof(T) >= 64) ? 1 : (64 / sizeof(T)); }
+
+  size_t nblocks() const noexcept { return stamps_.size(); }
+
+  size_t block_begin(const size_t b) const noexcept { return b * block_; }
+
+  size_t block_end(const size_t b) const noexcept { return std::min(data_.size(), (b + 1) * block_); }
+
+public:
+
+  using value_type = T;
+
+  /// Vector of \c size copies of \c value tracked in blocks of \c block elements (by default, a cache line)
+  explicit SpecTrackedVector(const size_t size = 0, const T& value = T(), const size_t block = default_block()) :
+  data_(size, value),
+  stamps_((size + std::max(block, static_cast<size_t>(1)) - 1) / std::max(block, static_cast<size_t>(1))),
+  block_{std::max(block, static_cast<size_t>(1))},
+  stamp_{new_stamp()}
+  {
+    std::fill(stamps_.begin(), stamps_.end(), stamp_);
+  }
+
+  SpecTrackedVector(const std::vector<T>& source, const size_t block = default_block()) :
+  SpecTrackedVector(0, T(), block)
+  {
+    assign(source.begin(), source.end());
+  }
+
+  template<std::size_t N>
+  SpecTrackedVector(const std::array<T, N>& source, const size_t block = default_block()) :
+  SpecTrackedVector(0, T(), block)
+  {
+    assign(source.begin(), source.end());
+  }
+
+  SpecTrackedVector(const SpecTrackedVector& other) :
+  data_(other.data_),
+  stamps_(other.stamps_),
+  block_{other.block_},
+  stamp_{new_stamp()}
+  {
+    other.stamp_ = new_stamp();
+  }
+
+  SpecTrackedVector(SpecTrackedVector&& other) noexcept :
+  data_(std::move(other.data_)),
+  stamps_(std::move(other.stamps_)),
+  block_{other.block_},
+  stamp_{other.stamp_}
+  {
+    other.stamp_ = new_stamp();
+  }
+
+  SpecTrackedVector& operator=(const SpecTrackedVector& other)
+  {
+    if (this != &other) {
+      if ((data_.size() != other.data_.size()) || (block_ != other.block_)) {
+        data_ = other.data_;
+        stamps_ = other.stamps_;
+        block_ = other.block_;
+      } else {
+        for (size_t b = 0; b < nblocks(); ++b) {
+          if (stamps_[b] != other.stamps_[b]) {
+            std::copy(other.data_.begin() + block_begin(b), other.data_.begin() + block_end(b), data_.begin() + block_begin(b));
+            stamps_[b] = other.stamps_[b];
+          }
+        }
+      }
+      other.stamp_ = new_stamp();
+    }
+    return *this;
+  }
+
+  SpecTrackedVector& operator=(SpecTrackedVector&& other) noexcept
+  {
+    if (this != &other) {
+      data_ = std::move(other.data_);
+      stamps_ = std::move(other.stamps_);
+      block_ = other.block_;
+      stamp_ = other.stamp_;
+      other.stamp_ = new_stamp();
+    }
+    return *this;
+  }
+
+  /// Replaces the contents with those of the range [\c first, \c last), all of them marked as written
+  template<typename It>
+  void assign(It first, It last)
+  {
+    data_.assign(first, last);
+    stamps_.assign((data_.size() + block_ - 1) / block_, stamp_);
+  }
+
+  bool operator==(const SpecTrackedVector& other) const
+  {
+    if ((data_.size() != other.data_.size()) || (block_ != other.block_)) {
+      return data_ == other.data_;
+    }
+    for (size_t b = 0; b < nblocks(); ++b) {
+      if ((stamps_[b] != other.stamps_[b]) && !std::equal(data_.begin() + block_begin(b), data_.begin() + block_end(b), other.data_.begin() + block_begin(b))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const SpecTrackedVector& other) const
+  {
+    return !(*this == other);
+  }
+
+  size_t size() const noexcept { return data_.size(); }
+
+  /// Number of elements tracked together
+  size_t block() const noexcept { return block_; }
+
+  /// Access for writing, which marks the block of the element as written
+  T& operator[](const size_t i) noexcept
+  {
+    assert(i < data_.size());
+    stamps_[i / block_] = stamp_;
+    return data_[i];
+  }
+
+  const T& operator[](const size_t i) const noexcept { return data_[i]; }
+
+  /// Access for reading, which does not mark the block of the element as written
+  const T& get(const size_t i) const noexcept { return data_[i]; }
+
+  void set(const size_t i, const T& value) noexcept { (*this)[i] = value; }
+
+  /// Contents of the vector, which must not be modified through it
+  const std::vector<T>& values() const noexcept { return data_; }
+
+};
+
+}
+
+#endif
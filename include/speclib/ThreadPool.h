@@ -7,7 +7,7 @@
 
 ///
 /// \file     ThreadPool.h
-/// \brief    Provides a resizeable reusable pool of threads
+/// \brief    Provides a reusable pool of threads shared by concurrent teams
 /// \author   Millan A. Martinez  <millan.alvarez@udc.es>
 /// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
 /// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
@@ -18,123 +18,405 @@
 #ifndef __THREADPOOL_H_
 #define __THREADPOOL_H_
 
+#include <algorithm>
 #include <vector>
+#include <memory>
 #include <thread>
+#include <atomic>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
+#include <cstddef>
+#include <new>
 
-/// \brief Resizeable and reusable pool of threads
-/// \internal It must be manipulated by an external main thread, not one in the pool
+/// \brief Reusable and resizeable pool of threads that can serve several teams of threads concurrently
+/// \internal Teams can be launched from any thread, including the ones in the pool.
+///           Each thread of the pool belongs at most to one team at a time.
+///           Threads are created on demand, and idle threads can be terminated with ::resize.
+///           A thread that finishes its work for a team keeps polling for a while for a new one
+///           before it blocks, and launches hand their teams to these threads through tickets in a
+///           lock-free ring, so that short loops run back to back do not pay for locks or wake-ups.
+///           Launches only create threads up to a limit, by default the number of hardware threads,
+///           so that concurrent teams share the available threads instead of oversubscribing the machine
 class ThreadPool {
-  
-  std::vector<std::thread> threads_;
+
+public:
+
+  /// \brief Group of threads of the pool that run the same function
+  /// \internal It must outlive the execution of its threads, which is ensured by its destructor
+  class Team {
+
+    /// Functions that fit in this space are stored inline, avoiding heap allocations
+    static constexpr size_t InlineSize = 4 * sizeof(void *);
+
+    alignas(std::max_align_t) unsigned char storage_[InlineSize];
+    void *target_;              //< Function to run, either in ::storage_ or in the heap
+    void (*invoke_)(void *);
+    void (*destroy_)(void *, bool);
+    std::atomic<size_t> running_; //< Number of threads of the team that have not finished yet
+
+    friend class ThreadPool;
+
+    static void noop(void *) noexcept { }
+
+    void run() { invoke_(target_); }
+
+    void reset() noexcept
+    {
+      if (destroy_ != nullptr) {
+        destroy_(target_, target_ == static_cast<void *>(storage_));
+        destroy_ = nullptr;
+      }
+      target_ = nullptr;
+      invoke_ = &Team::noop;
+    }
+
+  public:
+
+    Team() :
+    target_{nullptr}, invoke_{&Team::noop}, destroy_{nullptr}, running_{0}
+    { }
+
+    Team(const Team&) = delete;
+    Team& operator=(const Team&) = delete;
+
+    template<class F, class... Args>
+    void setFunction(F&& f, Args&&... args)
+    {
+      using Bound_t = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+      reset();
+      if ((sizeof(Bound_t) <= InlineSize) && (alignof(Bound_t) <= alignof(std::max_align_t))) {
+        target_ = new (storage_) Bound_t(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+      } else {
+        target_ = new Bound_t(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+      }
+      invoke_ = [](void * const p) { (*static_cast<Bound_t *>(p))(); };
+      destroy_ = [](void * const p, const bool is_inline) {
+        if (is_inline) {
+          static_cast<Bound_t *>(p)->~Bound_t();
+        } else {
+          delete static_cast<Bound_t *>(p);
+        }
+      };
+    }
+
+    /// ensure all threads of the team finished. Yields the CPU while waiting
+    void wait() const noexcept
+    {
+      while(running_.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+    }
+
+    ~Team()
+    {
+      wait();
+      reset();
+    }
+
+  };
+
+private:
+
+  struct Worker {
+    Team *team_ = nullptr; //< Team the thread currently works for, nullptr if it is idle
+    bool retire_ = false;  //< The thread must terminate
+    std::condition_variable cond_var_;
+    std::thread thread_;
+  };
+
+  /// Capacity of the ring of tickets, which bounds the number of threads polling for a team
+  static constexpr size_t RingSize = 256;
+
+  /// Polls for a new team before yielding the CPU between them
+  static constexpr size_t SpinPolls = 64;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<Worker *> idle_;
   std::mutex mutex_;
-  std::condition_variable cond_var_;
-  std::function<void()> func_;
-  volatile size_t nthreads_in_use_; //< Number of threads that participate in parallel executions
-  volatile size_t count_;
-  volatile bool ready_, finish_;
+  std::atomic<bool> finish_;
+  const size_t poll_limit_;          //< Polls for a new team before blocking
+  const size_t max_threads_;         //< Threads up to which launches create new ones, 0 for no limit
+  std::atomic<size_t> spinning_;     //< Polling threads not claimed yet by a launch
+  std::atomic<size_t> polling_;      //< Polling threads, including those claimed and those about to block
+  std::atomic<size_t> hold_;         //< Number of ::resize in progress, which stop the polling
+  std::atomic<size_t> busy_;         //< Threads launched for a team that have not finished their work for it
+  std::atomic<size_t> ring_head_;    //< Next ticket to take
+  std::atomic<size_t> ring_tail_;    //< Next ticket to issue
+  std::atomic<Team *> ring_[RingSize];
 
-  void main()
+  /// Creates a new idle thread. Must be called with mutex_ locked
+  Worker *add_worker()
   {
-    while (!finish_) {
-      std::unique_lock<std::mutex> my_lock(mutex_);
-      while (!ready_ && !finish_) {
-        cond_var_.wait(my_lock);
-      }
-#if __cplusplus < 202002L
-      const size_t my_id = count_++;
-#else
-      // '++' expression of 'volatile'-qualified type is deprecated in C++20
-      const size_t my_id = count_;
-      count_ = count_ + 1;
-#endif
-      if(count_ == threads_.size()) {
-        ready_ = false;
+    workers_.emplace_back(new Worker());
+    Worker * const w = workers_.back().get();
+    w->thread_ = std::thread(&ThreadPool::main, this, w);
+    return w;
+  }
+
+  /// Tries to join the threads polling for a team
+  bool start_polling() noexcept
+  {
+    if (!poll_limit_ || hold_.load() || finish_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (polling_.fetch_add(1) >= RingSize || hold_.load()) {
+      polling_.fetch_sub(1);
+      return false;
+    }
+    spinning_.fetch_add(1);
+    return true;
+  }
+
+  /// Takes a ticket if there is any, returning its team
+  Team *take_ticket() noexcept
+  {
+    size_t head = ring_head_.load(std::memory_order_acquire);
+    while (head != ring_tail_.load(std::memory_order_acquire)) {
+      if (ring_head_.compare_exchange_weak(head, head + 1)) {
+        Team *team;
+        // the launcher issues the ticket before it stores the team
+        while ((team = ring_[head % RingSize].exchange(nullptr, std::memory_order_acquire)) == nullptr) {
+          std::this_thread::yield();
+        }
+        return team;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Polls for a team. Returns nullptr when the thread stops polling, which it can only do
+  /// if it has not been claimed by a launch
+  Team *poll() noexcept
+  {
+    for (size_t polls = 0; ; polls++) {
+      Team * const team = take_ticket();
+      if (team != nullptr) {
+        polling_.fetch_sub(1);
+        return team;
+      }
+      if ((polls >= poll_limit_) || hold_.load(std::memory_order_relaxed) || finish_.load(std::memory_order_relaxed)) {
+        size_t unclaimed = spinning_.load();
+        while (unclaimed && !spinning_.compare_exchange_weak(unclaimed, unclaimed - 1));
+        if (unclaimed) {
+          return nullptr;
+        }
+        // otherwise a launch claimed this thread and its ticket is on its way
       }
+      if (polls >= SpinPolls) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void main(Worker * const w)
+  {
+    std::unique_lock<std::mutex> my_lock(mutex_);
+    while (true) {
+      while ((w->team_ == nullptr) && !w->retire_ && !finish_.load(std::memory_order_relaxed)) {
+        w->cond_var_.wait(my_lock);
+      }
+      Team *team = w->team_;
+      if (team == nullptr) {
+        break;
+      }
+      w->team_ = nullptr;
       my_lock.unlock();
-      
-      if (!finish_ && (my_id < nthreads_in_use_)) {
-        func_();
+
+      bool polling = false;
+      while (team != nullptr) {
+        team->run();
+        polling = start_polling();
+        busy_.fetch_sub(1, std::memory_order_relaxed);
+        // last access to the team, which may be destroyed as soon as it sees no running threads
+        team->running_.fetch_sub(1, std::memory_order_release);
+        team = polling ? poll() : nullptr;
       }
-      
-      while(ready_ && !finish_) {} // ensure all threads restarted
+
       my_lock.lock();
-#if __cplusplus < 202002L
-      count_--;
-#else
-      // '--' expression of 'volatile'-qualified type is deprecated in C++20
-      count_ = count_ - 1;
-#endif
-      my_lock.unlock();
-      
-      //wait();
+      idle_.push_back(w);
+      if (polling) {
+        polling_.fetch_sub(1);
+      }
     }
+  }
+
+  /// Claims up to \c n polling threads, returning how many were claimed
+  size_t claim_polling(const size_t n) noexcept
+  { size_t k;
+
+    size_t available = spinning_.load(std::memory_order_relaxed);
+    do {
+      k = std::min(available, n);
+    } while (k && !spinning_.compare_exchange_weak(available, available - k));
+    return k;
+  }
+
+  /// Reserves the threads of a team of up to \c n threads: all of them while the busy threads leave
+  /// room within the limit of the pool, and at least one so that every team can make progress
+  size_t reserve_share(const size_t n) noexcept
+  { size_t k;
 
+    const size_t limit = std::max(max_threads_, n);
+    size_t busy = busy_.load(std::memory_order_relaxed);
+    do {
+      k = std::min(n, std::max((busy < limit) ? (limit - busy) : 0, static_cast<size_t>(1)));
+    } while (!busy_.compare_exchange_weak(busy, busy + k, std::memory_order_relaxed));
+    return k;
+  }
+
+  /// Stops the polling and waits for the polling threads to block or get a team
+  void hold() noexcept
+  {
+    hold_.fetch_add(1);
+    while (polling_.load()) {
+      std::this_thread::yield();
+    }
   }
 
 public:
-  
-  ThreadPool(const size_t n) :
-  func_{[]{}}, count_{0}, ready_{false}, finish_{false}
+
+  /// \param n           initial number of threads
+  /// \param poll_limit  polls for a new team of the threads that finish their work before they block.
+  ///                    0 makes them block immediately
+  /// \param max_threads size up to which launches grow the pool, 0 for no limit
+  ThreadPool(const size_t n, const size_t poll_limit = 4096, const size_t max_threads = std::thread::hardware_concurrency()) :
+  finish_{false},
+  poll_limit_{poll_limit},
+  max_threads_{max_threads},
+  spinning_{0},
+  polling_{0},
+  hold_{0},
+  busy_{0},
+  ring_head_{0},
+  ring_tail_{0}
   {
+    for (auto& slot : ring_) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
     resize(n);
   }
-  
-  size_t nthreads() const noexcept { return nthreads_in_use_; }
 
-  /// \brief Change the number of threads in the pool
-  /// \internal When the new number is larger than the actual number of threads currently
-  ///           in the pool, new threads are created. But when the new number is smaller
-  ///           the class simply changes the number of threads in use so that only the
-  ///           required ones do work
-  void resize(const size_t new_nthreads)
+  /// Total number of threads in the pool, either working or idle
+  size_t nthreads() noexcept
   {
-    wait();
+    std::lock_guard<std::mutex> my_guard_lock(mutex_);
+    return workers_.size();
+  }
 
-    // can only grow
-    while (threads_.size() < new_nthreads) {
-      threads_.emplace_back(&ThreadPool::main, this);
+  /// \brief Ensures the pool has at least \c new_nthreads threads
+  void reserve(const size_t new_nthreads)
+  {
+    std::lock_guard<std::mutex> my_guard_lock(mutex_);
+    while (workers_.size() < new_nthreads) {
+      idle_.push_back(add_worker());
     }
-    nthreads_in_use_ = new_nthreads;
   }
 
-  void launchTheads()
+  /// \brief Change the number of threads in the pool
+  /// \internal When the pool shrinks, idle threads are terminated and joined until \c new_nthreads
+  ///           remain. Threads working for a team are not affected, so the pool can end up larger
+  void resize(const size_t new_nthreads)
   {
-    if (nthreads_in_use_) {
-      wait();
-      {
-        std::lock_guard<std::mutex> my_guard_lock(mutex_);
-        ready_ = true;
+    std::vector<std::unique_ptr<Worker>> retired;
+
+    hold();
+    {
+      std::lock_guard<std::mutex> my_guard_lock(mutex_);
+      while (workers_.size() < new_nthreads) {
+        idle_.push_back(add_worker());
+      }
+      while ((workers_.size() > new_nthreads) && !idle_.empty()) {
+        Worker * const w = idle_.back();
+        idle_.pop_back();
+        w->retire_ = true;
+        w->cond_var_.notify_one();
+        const auto it = std::find_if(workers_.begin(), workers_.end(), [w](const std::unique_ptr<Worker>& p) { return p.get() == w; });
+        retired.push_back(std::move(*it));
+        workers_.erase(it);
       }
-      cond_var_.notify_all();
+    }
+    hold_.fetch_sub(1);
+
+    for (auto& w : retired) {
+      w->thread_.join();
     }
   }
-  
-  template<class F, class... Args>
-  void setFunction(F&& f, Args&&... args)
-  {
-    func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-  }
-  
-  /// ensure all threads finished. Spin wait
-  void wait() const noexcept
+
+  /// \brief Runs the function of \c team in up to \c n threads of the pool
+  /// \param only_idle if true, at most the currently idle threads are used, and no thread is created
+  /// \return number of threads actually launched, which is at least one unless \c only_idle is true
+  /// \internal Threads polling for a team are used first, without locks, then idle threads, and new
+  ///           threads are created if there are not enough. A team alone gets all the threads it asks
+  ///           for, while concurrent teams only get the threads that their busy threads leave within
+  ///           the limit of the pool, and at least one so that every team can make progress
+  size_t launch(Team& team, size_t n, const bool only_idle = false)
   {
-    while(ready_ || count_) {};
+    if (n) {
+      if (!only_idle && max_threads_) {
+        n = reserve_share(n);
+      }
+      size_t claimed = claim_polling(n);
+      if (claimed < n) {
+        std::unique_lock<std::mutex> my_lock(mutex_);
+        // threads that stop polling become idle soon, so they are waited for rather than replaced.
+        //Teams that only take the idle threads can do without them instead
+        while (!only_idle && !claimed && idle_.empty() && polling_.load()) {
+          my_lock.unlock();
+          std::this_thread::yield();
+          claimed = claim_polling(n);
+          my_lock.lock();
+        }
+        size_t m = n - claimed;
+        if (only_idle) {
+          m = std::min(m, idle_.size());
+        }
+        if (only_idle || !max_threads_) {
+          busy_.fetch_add(claimed + m, std::memory_order_relaxed);
+        }
+        n = claimed + m;
+        team.running_.fetch_add(n, std::memory_order_relaxed);
+        for (size_t i = 0; i < m; i++) {
+          Worker *w;
+          if (idle_.empty()) {
+            w = add_worker();
+          } else {
+            w = idle_.back();
+            idle_.pop_back();
+          }
+          w->team_ = &team;
+          w->cond_var_.notify_one();
+        }
+      } else {
+        if (only_idle || !max_threads_) {
+          busy_.fetch_add(n, std::memory_order_relaxed);
+        }
+        team.running_.fetch_add(n, std::memory_order_relaxed);
+      }
+      for (size_t i = 0; i < claimed; i++) {
+        const size_t ticket = ring_tail_.fetch_add(1);
+        ring_[ticket % RingSize].store(&team, std::memory_order_release);
+      }
+    }
+    return n;
   }
-  
+
   ~ThreadPool()
   {
-    wait();
-    
-    finish_ = true;
-    launchTheads();
-    for (auto& thread : threads_) {
-      thread.join();
+    hold();
+    {
+      std::lock_guard<std::mutex> my_guard_lock(mutex_);
+      finish_.store(true);
+      for (auto& w : workers_) {
+        w->cond_var_.notify_one();
+      }
+    }
+    for (auto& w : workers_) {
+      w->thread_.join();
     }
   }
-  
+
 };
 
 #endif
@@ -22,16 +22,24 @@
 #include <type_traits>
 #include <array>
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 #include "speclib/SpecConsecVector.h"
 #include "speclib/ReductionVar.h"
+#include "speclib/SpecPredicted.h"
+#include "speclib/SpecRepairable.h"
 #include "speclib/SpecVector.h"
+#include "speclib/SpecTrackedVector.h"
+#include "speclib/SpecCowVector.h"
 #include "speclib/SpecReal.h"
 #include "speclib/SpecRealInd.h"
 #include "speclib/SpecAtomic.h"
+#include "speclib/Affinity.h"
 #ifdef SLSTATS
 #include <chrono>
 #endif
@@ -138,6 +146,7 @@ struct StatsRunInfo {
   unsigned long long int failures;
   unsigned long long int sequential;
   unsigned long long int total;
+  unsigned long long int salvaged; ///< Sequential runs that resumed from the snapshots of a cancelled chunk. Not included in ::total
   double total_exec_time;
   StatsProfileTimers pt;
 
@@ -147,34 +156,37 @@ struct StatsRunInfo {
     failures(0),
     sequential(0),
     total(0),
+    salvaged(0),
     total_exec_time(0.0)
   {
     pt.reset();
   }
 
-  StatsRunInfo(size_t totalNthreads_, unsigned long long int successes_, unsigned long long int failures_, unsigned long long int sequential_, double total_exec_time_ = 0.0) :
+  StatsRunInfo(size_t totalNthreads_, unsigned long long int successes_, unsigned long long int failures_, unsigned long long int sequential_, double total_exec_time_ = 0.0, unsigned long long int salvaged_ = 0) :
     totalNthreads(totalNthreads_),
     successes(successes_),
     failures(failures_),
     sequential(sequential_),
     total(successes + failures + sequential),
+    salvaged(salvaged_),
     total_exec_time(total_exec_time_)
   {
     pt.reset();
   }
 
-  StatsRunInfo(size_t totalNthreads_, unsigned long long int successes_, unsigned long long int failures_, unsigned long long int sequential_, double total_exec_time_, StatsProfileTimers pt_) :
+  StatsRunInfo(size_t totalNthreads_, unsigned long long int successes_, unsigned long long int failures_, unsigned long long int sequential_, double total_exec_time_, StatsProfileTimers pt_, unsigned long long int salvaged_ = 0) :
     totalNthreads(totalNthreads_),
     successes(successes_),
     failures(failures_),
     sequential(sequential_),
     total(successes + failures + sequential),
+    salvaged(salvaged_),
     total_exec_time(total_exec_time_),
     pt(pt_)
   { }
 
   StatsRunInfo operator+ (const StatsRunInfo& first) const {
-    return StatsRunInfo(totalNthreads ? totalNthreads : first.totalNthreads, successes + first.successes, failures + first.failures, sequential + first.sequential, total_exec_time + first.total_exec_time, pt + first.pt);
+    return StatsRunInfo(totalNthreads ? totalNthreads : first.totalNthreads, successes + first.successes, failures + first.failures, sequential + first.sequential, total_exec_time + first.total_exec_time, pt + first.pt, salvaged + first.salvaged);
   }
 
   StatsRunInfo& operator+= (const StatsRunInfo& first) {
@@ -183,6 +195,7 @@ struct StatsRunInfo {
     failures += first.failures;
     sequential += first.sequential;
     total += first.successes + first.failures + first.sequential;
+    salvaged += first.salvaged;
     total_exec_time += first.total_exec_time;
     pt += first.pt;
     return *this;
@@ -193,6 +206,7 @@ struct StatsRunInfo {
     failures = 0;
     sequential = 0;
     total = 0;
+    salvaged = 0;
     total_exec_time = 0.0;
     pt.reset();
   }
@@ -201,8 +215,24 @@ struct StatsRunInfo {
 
 struct Configuration {
 
-  size_t nthreads_;  ///< Total number of threads to use for the loop execution
+  size_t nthreads_;  ///< Total number of threads to use for the loop execution. Loops run concurrently with others may get fewer, as they share the hardware threads
   size_t min_paral_nthreads_; ///< Minimum number of threads to use for parallel execution of chunks
+  size_t min_chunk_size_ = 0; ///< Minimum number of iterations of a chunk when its size is adaptive
+  size_t max_chunk_size_ = 0; ///< Maximum number of iterations of a chunk when its size is adaptive (0 to disable the adaptive size)
+  unsigned int grow_chunk_after_ = 2; ///< Number of consecutive successful validations after which the adaptive chunk size grows
+  size_t dynamic_block_size_ = 0; ///< Iterations claimed at a time by the threads that run the parallel part of a chunk (0 to split it evenly among them)
+  size_t max_spec_depth_ = 0; ///< Maximum number of chunks whose sequential run is in flight at the same time (0 for no limit other than the number of threads)
+  size_t idle_spins_ = std::numeric_limits<size_t>::max(); ///< Busy polls for work of an idle thread before it starts yielding the CPU (the maximum value to always spin)
+  size_t idle_yields_ = std::numeric_limits<size_t>::max(); ///< Polls for work yielding the CPU before an idle worker blocks until a new chunk is pushed (the maximum value to never block)
+  Affinity affinity_ = Affinity::None; ///< Placement of the threads of the loop. The calling thread takes the first CPU, the thread that runs the sequential part of a chunk moves to the second one, whose physical core is kept for these runs, and the workers take the rest. Only one loop at a time is placed with Affinity::Compact or Affinity::Scatter, the threads of those run concurrently with it are not pinned
+  std::vector<int> cpu_list_; ///< CPUs to use, in order, with Affinity::List
+  float fallback_failure_ratio_ = 0.0f; ///< Ratio of failed validations among the last ::fallback_window_ ones above which the loop falls back to a sequential run on the calling thread (0 to disable)
+  unsigned int fallback_window_ = 16; ///< Number of the most recent validations considered for the fallback, at most 64
+  size_t fallback_probe_after_ = 0; ///< Iterations run sequentially after a fallback before trying speculation again (0 to run the rest of the loop)
+  size_t doall_after_ = 0; ///< Consecutive validations whose sequential results match the speculated ones after which the chunks skip their sequential run, as in a DOALL loop (0 to disable). A dependence is only detected if it appears in a chunk that keeps it as a probe, which rolls the loop back. Ignored for SpecVector, SpecConsecVector and ReductionVar arguments
+  size_t doall_probe_every_ = 8; ///< While the sequential runs are skipped, one in this number of chunks still runs and validates it to detect dependences
+  size_t checkpoint_interval_ = 0; ///< Iterations between snapshots of the sequential run of a chunk, used to shorten its rerun after a failed validation (0 to disable). Ignored for SpecVector, SpecConsecVector and ReductionVar arguments
+  size_t memo_capacity_ = 0; ///< Maximum number of results of sequential runs of chunks remembered to reuse them when the same chunk runs again from the same state, as after failed validations (0 to disable). Runs are only remembered while validations have failed recently. Only valid if the loop body only changes its arguments. Ignored for SpecVector, SpecConsecVector and ReductionVar arguments
 #ifdef SLSIMULATE
   float simulate_ratio_successes_ = -1.0f; ///< Simulate the percent of successes (negative number to disable)
 #endif
@@ -224,6 +254,173 @@ struct Configuration {
 
 namespace internal {
 
+/// Size of the speculative chunks, which can adapt to the outcome of the validations
+/** In adaptive mode the size is doubled after a given number of consecutive successful
+    validations and halved after every failed one, always within the user bounds.
+    Sizes are expressed in units of the loop index, thus they are multiples of the step.
+ */
+class ChunkSize_t {
+
+  std::atomic<size_t> size_;  ///< Current size of the chunks
+  size_t min_size_;           ///< Lower bound of the size in adaptive mode
+  size_t max_size_;           ///< Upper bound of the size in adaptive mode
+  size_t unit_;               ///< Absolute value of the step of the loop
+  unsigned int grow_after_;   ///< Number of consecutive successes required to grow
+  std::atomic<unsigned int> consecutive_successes_;
+
+public:
+
+  ChunkSize_t() :
+  size_{0},
+  min_size_{0},
+  max_size_{0},
+  unit_{1},
+  grow_after_{1},
+  consecutive_successes_{0}
+  {}
+
+  /// \brief Prepares the object for a new loop
+  /// \param size       Initial size of the chunks
+  /// \param unit       Absolute value of the step of the loop
+  /// \param min_iters  Minimum number of iterations per chunk in adaptive mode
+  /// \param max_iters  Maximum number of iterations per chunk in adaptive mode (0 for a fixed size)
+  /// \param grow_after Number of consecutive successful validations after which the size grows
+  void reset(const size_t size, const size_t unit, const size_t min_iters, const size_t max_iters, const unsigned int grow_after) noexcept
+  {
+    unit_ = unit;
+    if (max_iters) {
+      max_size_ = std::max(max_iters, static_cast<size_t>(1)) * unit;
+      min_size_ = std::min(std::max(min_iters, static_cast<size_t>(1)) * unit, max_size_);
+      size_.store(std::min(std::max(size, min_size_), max_size_), std::memory_order_relaxed);
+    } else {
+      min_size_ = max_size_ = size;
+      size_.store(size, std::memory_order_relaxed);
+    }
+    grow_after_ = std::max(grow_after, 1u);
+    consecutive_successes_.store(0, std::memory_order_relaxed);
+  }
+
+  bool adaptive() const noexcept { return min_size_ != max_size_; }
+
+  size_t get() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+  /// Notify a successful validation of a speculative chunk
+  void success() noexcept
+  {
+    if (adaptive() && (consecutive_successes_.fetch_add(1, std::memory_order_relaxed) + 1 >= grow_after_)) {
+      consecutive_successes_.store(0, std::memory_order_relaxed);
+      size_.store(std::min(get() * 2, max_size_), std::memory_order_relaxed);
+    }
+  }
+
+  /// Notify a failed validation of a speculative chunk
+  void failure() noexcept
+  {
+    if (adaptive()) {
+      consecutive_successes_.store(0, std::memory_order_relaxed);
+      size_.store(std::max(get() / (2 * unit_) * unit_, min_size_), std::memory_order_relaxed);
+    }
+  }
+
+};
+
+/// Rolling ratio of failed validations that decides when speculation is not worth it
+class FallbackMonitor_t {
+
+  std::atomic<std::uint64_t> outcomes_; ///< Bit i is set if the i-th most recent validation failed
+  std::atomic<unsigned int> seen_;      ///< Validations observed since the last reset, saturated at the window
+  unsigned int window_;                 ///< Number of validations considered
+  unsigned int max_failures_;           ///< Failures in the window above which speculation is abandoned (0 if disabled)
+
+  void push(const std::uint64_t failed) noexcept
+  {
+    std::uint64_t prev = outcomes_.load(std::memory_order_relaxed);
+    while (!outcomes_.compare_exchange_weak(prev, (prev << 1) | failed, std::memory_order_relaxed));
+    if (seen_.load(std::memory_order_relaxed) < window_) {
+      seen_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+public:
+
+  FallbackMonitor_t() :
+  outcomes_{0},
+  seen_{0},
+  window_{1},
+  max_failures_{0}
+  {}
+
+  /// Prepares the object for a new loop
+  /// \param ratio  Ratio of failures in the window above which speculation is abandoned (0 to disable)
+  /// \param window Number of the most recent validations considered
+  void reset(const float ratio, const unsigned int window) noexcept
+  {
+    window_ = std::min(std::max(window, 1u), 64u);
+    max_failures_ = (ratio > 0.0f) ? static_cast<unsigned int>(ratio * static_cast<float>(window_)) : 0;
+    clear();
+  }
+
+  /// Forgets the validations observed
+  void clear() noexcept
+  {
+    outcomes_.store(0, std::memory_order_relaxed);
+    seen_.store(0, std::memory_order_relaxed);
+  }
+
+  bool enabled() const noexcept { return max_failures_ != 0; }
+
+  void success() noexcept { if (enabled()) { push(0); } }
+
+  void failure() noexcept { if (enabled()) { push(1); } }
+
+  /// Whether the window is full and the ratio of failures in it exceeds the threshold
+  bool tripped() const noexcept
+  {
+    if (!enabled() || (seen_.load(std::memory_order_relaxed) < window_)) {
+      return false;
+    }
+    std::uint64_t failures = outcomes_.load(std::memory_order_relaxed) & ((window_ == 64) ? ~static_cast<std::uint64_t>(0) : ((static_cast<std::uint64_t>(1) << window_) - 1));
+    unsigned int count = 0;
+    for (; failures; failures &= failures - 1) {
+      count++;
+    }
+    return count >= max_failures_;
+  }
+
+};
+
+/// End of a loop run by ::specWhile, which is part of the values on which the speculation is performed
+/** Once the body ends the loop, the chunks that start from these values do not run any iteration,
+    so that the iterations run speculatively past the end have no effect */
+template<typename Ti>
+class LoopExit_t {
+
+  Ti last_;      ///< Last iteration run, valid only if the loop ended
+  bool exited_;
+
+public:
+
+  LoopExit_t() noexcept :
+  last_{},
+  exited_{false}
+  {}
+
+  bool exited() const noexcept { return exited_; }
+
+  Ti last() const noexcept { return last_; }
+
+  /// Ends the loop after \c iteration
+  void exit(const Ti iteration) noexcept
+  {
+    last_ = iteration;
+    exited_ = true;
+  }
+
+  bool operator==(const LoopExit_t& other) const noexcept { return (exited_ == other.exited_) && (!exited_ || (last_ == other.last_)); }
+
+  bool operator!=(const LoopExit_t& other) const noexcept { return !(*this == other); }
+
+};
 
 #ifdef THREADINSTRUMENT
 
@@ -259,6 +456,41 @@ struct SpecType {
   using type = typename std::remove_reference<T>::type;
 };
 
+/// Whether snapshots of the values of type \c T can be taken and compared to resume sequential runs
+template <typename T>
+struct Checkpointable : std::true_type {};
+
+template <typename T>
+struct Checkpointable<SpecConsecVector<T>> : std::false_type {};
+
+template <typename T, typename U>
+struct Checkpointable<SpecVector<T, U>> : std::false_type {};
+
+template <typename T, typename Op>
+struct Checkpointable<ReductionVar<T, Op>> : std::false_type {};
+
+/// Starts needed to repair a value of type \c T in a chunk: the true one and the speculated one
+struct NoRepairStarts_t {};
+
+template <typename T>
+struct RepairStarts {
+  using type = NoRepairStarts_t;
+};
+
+template <typename T, typename R>
+struct RepairStarts<SpecRepairable<T, R>> {
+  using type = std::pair<T, T>;
+};
+
+template <typename T>
+using IsRepairable = std::integral_constant<bool, !std::is_same<typename RepairStarts<T>::type, NoRepairStarts_t>::value>;
+
+template <typename... T>
+using AnyRepairable = std::integral_constant<bool, !std::is_same<std::integer_sequence<bool, false, IsRepairable<T>::value...>, std::integer_sequence<bool, IsRepairable<T>::value..., false>>::value>;
+
+template <typename... T>
+using AllCheckpointable = std::is_same<std::integer_sequence<bool, true, Checkpointable<T>::value...>, std::integer_sequence<bool, Checkpointable<T>::value..., true>>;
+
 
 template <const bool PosStep, typename T, typename Ti>
 static inline T spec_version(T& v, const Ti, const size_t)
@@ -317,8 +549,8 @@ template <typename T>
 static inline void initialize_if_ReductionVar(T&)
 { }
 
-template <typename T>
-static inline void initialize_if_ReductionVar(ReductionVar<T>& v)
+template <typename T, typename Op>
+static inline void initialize_if_ReductionVar(ReductionVar<T, Op>& v)
 {
   v.initialize();
 }
@@ -327,12 +559,94 @@ template <typename T>
 static inline void reduce_if_ReductionVar(T&)
 { }
 
-template <typename T>
-static inline void reduce_if_ReductionVar(ReductionVar<T>& v)
+template <typename T, typename Op>
+static inline void reduce_if_ReductionVar(ReductionVar<T, Op>& v)
 {
   v.reduce();
 }
 
+template <typename T>
+static inline void collect_if_ReductionVar(T&)
+{ }
+
+template <typename T, typename Op>
+static inline void collect_if_ReductionVar(ReductionVar<T, Op>& v)
+{
+  v.collect();
+}
+
+
+
+template <typename T>
+static inline void start_if_SpecPredicted(T&, const long long)
+{ }
+
+template <typename T, size_t CAPACITY>
+static inline void start_if_SpecPredicted(SpecPredicted<T, CAPACITY>& v, const long long iteration)
+{
+  v.start(iteration);
+}
+
+template <typename T>
+static inline void record_if_SpecPredicted(T&, const long long)
+{ }
+
+template <typename T, size_t CAPACITY>
+static inline void record_if_SpecPredicted(SpecPredicted<T, CAPACITY>& v, const long long iteration)
+{
+  v.record(iteration);
+}
+
+template <typename T>
+static inline void predict_if_SpecPredicted(T&, const long long)
+{ }
+
+template <typename T, size_t CAPACITY>
+static inline void predict_if_SpecPredicted(SpecPredicted<T, CAPACITY>& v, const long long iteration)
+{
+  v.predict(iteration);
+}
+
+
+/// Whether \c seq and \c spec are equal or their difference can be repaired, recording the \c starts for the repair
+template <typename T>
+static inline bool match_or_repairable(const T& seq, const T& spec, NoRepairStarts_t&)
+{
+  return seq == spec;
+}
+
+template <typename T, typename R>
+static inline bool match_or_repairable(const SpecRepairable<T, R>& seq, const SpecRepairable<T, R>& spec, std::pair<T, T>& starts)
+{
+  starts.first = seq.value();
+  starts.second = spec.value();
+  return (seq == spec) || seq.repairable(seq.value(), spec.value());
+}
+
+template <typename T>
+static inline void repair_if_SpecRepairable(T&, const NoRepairStarts_t&)
+{ }
+
+template <typename T, typename R>
+static inline void repair_if_SpecRepairable(SpecRepairable<T, R>& v, const std::pair<T, T>& starts)
+{
+  if (!(starts.first == starts.second)) {
+    v.repair(starts.first, starts.second);
+  }
+}
+
+
+template <typename T>
+static inline bool exited_if_LoopExit(const T&)
+{
+  return false;
+}
+
+template <typename Ti>
+static inline bool exited_if_LoopExit(const LoopExit_t<Ti>& v)
+{
+  return v.exited();
+}
 
 
 template <typename T>
@@ -18,11 +18,16 @@
 #define _SPECLIB_STD_H_
 
 #include <type_traits>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include "speclib/ThreadPool.h"
 #include "speclib/LinkedListPool.h"
-#if defined(SLSTATS) || defined(SLMINIMALSTATS)
-#include <mutex>
-#endif
 #ifdef SLSIMULATE
 #include <random>
 #include <chrono>
@@ -72,10 +77,11 @@ struct ExCommonSpecInfo_t {
   const CommonSpecInfo_t& cs; ///< The common data associated with this set of speculative executions
   const bool isParExec; ///< True for executions of the parallel part, False for executions of the sequential part
   const bool fromSpeculative; ///< Variable indicating whether this set of speculative runs starts from a speculative initial value or not
+  const ExCommonSpecInfo_t * const parent; ///< Execution of the enclosing speculative loop for nested loops, nullptr otherwise
 
 #ifndef SLNOCANCEL
   bool cancelled() const noexcept {
-    return (cs.cancelled() && (isParExec || cs.failed()));
+    return (cs.cancelled() && (isParExec || cs.failed())) || ((parent != nullptr) && parent->cancelled());
   }
 #else
   constexpr bool cancelled() const noexcept {
@@ -83,10 +89,11 @@ struct ExCommonSpecInfo_t {
   }
 #endif
 
-  ExCommonSpecInfo_t(const CommonSpecInfo_t& cs_, const bool isParExec_, const bool fromSpeculative_) :
+  ExCommonSpecInfo_t(const CommonSpecInfo_t& cs_, const bool isParExec_, const bool fromSpeculative_, const ExCommonSpecInfo_t * const parent_ = nullptr) :
   cs(cs_),
   isParExec(isParExec_),
-  fromSpeculative(fromSpeculative_)
+  fromSpeculative(fromSpeculative_),
+  parent(parent_)
   {}
 
 };
@@ -97,12 +104,19 @@ namespace internal {
 auto real_rand_gen = std::bind(std::uniform_real_distribution<float>(0,1), std::mt19937(static_cast<std::mt19937::result_type>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch()).count())));
 #endif
 
-ThreadPool& SpecLibThreadPool()
+inline ThreadPool& SpecLibThreadPool()
 { static ThreadPool SpecLibThreadPool_(0);
   
   return SpecLibThreadPool_;
 }
 
+/// Speculative execution that the calling thread is running, nullptr if none
+inline const ExCommonSpecInfo_t *& CurrentExSpecInfo()
+{ static thread_local const ExCommonSpecInfo_t *CurrentExSpecInfo_ = nullptr;
+
+  return CurrentExSpecInfo_;
+}
+
 template<typename T, typename = decltype(&T::operator())>
 std::true_type  intl_supports_call_test(const T&);
 
@@ -144,24 +158,142 @@ struct Deduct_ExCommonSpecInfo_t<Ret (ClassT::*) (const ExCommonSpecInfo_t&, Arg
   using type = std::true_type;
 };
 
+/// Body that receives the iteration as an iterator, run on the positions of the range it traverses
+template<typename It, typename F>
+class IterBody_t {
+
+  using Distance_t = typename std::iterator_traits<It>::difference_type;
+
+  const It first_;
+  const F& f_;
+
+public:
+
+  IterBody_t(const It first, const F& f) :
+  first_{first},
+  f_{f}
+  { }
+
+  template<typename... ArgT>
+  void operator()(const Distance_t i, ArgT&... args) const
+  {
+    f_(first_ + i, args...);
+  }
+
+};
+
+/// Body that receives a whole chunk delimited by iterators, run on the positions of the range it traverses
+template<typename It, typename F>
+class IterChunkBody_t {
+
+  using Distance_t = typename std::iterator_traits<It>::difference_type;
+
+  const It first_;
+  const F& f_;
+
+public:
+
+  IterChunkBody_t(const It first, const F& f) :
+  first_{first},
+  f_{f}
+  { }
+
+  template<typename... ArgT>
+  void operator()(const ExCommonSpecInfo_t& exspec_info, const Distance_t begin, const Distance_t end, const Distance_t step, ArgT&... args) const
+  {
+    f_(exspec_info, first_ + begin, first_ + end, step, args...);
+  }
+
+};
+
+template<typename It, typename F>
+struct Deduct_ExCommonSpecInfo_t<IterChunkBody_t<It, F>> {
+  using type = std::true_type;
+};
+
+/// Body of a loop run by ::specWhile, where \c f returns false in the last iteration
+template<typename Ti, typename F>
+class WhileBody_t {
+
+  const F& f_;
+
+public:
+
+  WhileBody_t(const F& f) :
+  f_{f}
+  { }
+
+  template<typename... ArgT>
+  void operator()(const ExCommonSpecInfo_t& exspec_info, const Ti begin, const Ti end, const Ti step, LoopExit_t<Ti>& loop_exit, ArgT&... args) const
+  {
+    const bool pos_step = std::is_unsigned<Ti>::value || (step >= 0);
+    for (Ti i = begin; (pos_step ? (i < end) : (i > end)) && !loop_exit.exited() && !exspec_info.cancelled(); i += step) {
+      if (!f_(i, args...)) {
+        loop_exit.exit(i);
+      }
+    }
+  }
+
+};
+
+template<typename Ti, typename F>
+struct Deduct_ExCommonSpecInfo_t<WhileBody_t<Ti, F>> {
+  using type = std::true_type;
+};
+
+/// Body that runs \c f on the positions of the range that begins at \c It
+template<typename It, typename F>
+using IterBodyFor_t = std::conditional_t<Deduct_ExCommonSpecInfo_t<F>::type::value, IterChunkBody_t<It, F>, IterBody_t<It, F>>;
+
+/// Whether \c It is a random-access iterator
+template<typename It, typename = void>
+struct IsRandomAccessIterator : std::false_type {};
+
+template<typename It>
+struct IsRandomAccessIterator<It, std::enable_if_t<std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value>> : std::true_type {};
+
+/// Type of the iterators of the range \c R, void if it is not a range
+template<typename R, typename = void>
+struct RangeIterator_t {
+  using type = void;
+};
+
+template<typename R>
+struct RangeIterator_t<R, decltype(static_cast<void>(std::begin(std::declval<R&>())), static_cast<void>(std::end(std::declval<R&>())))> {
+  using type = decltype(std::begin(std::declval<R&>()));
+};
+
 template <const bool PosStep, typename F, typename Ti, typename... ArgT>
 class ThreadPoolHandler;
 
+/// Pool of the chunks of a loop, whose blocks are placed on the NUMA node of the thread that fills them
+template <typename Node>
+using NodePool_t = LinkedListPool<Node, NodeLocalAllocator_t>;
+
 /// Supports the parallel execution of a chunk
 template <const bool PosStep, typename F, typename Ti, typename... ArgT>
 class WorkNode {
 
   using TupleVal_t = typename ChunkVals_t<ArgT...>::TupleVal_t;
+  using RepairStarts_t = std::tuple<typename RepairStarts<ArgT>::type...>;
 
   static constexpr int Disabled = 0x4000;
-  size_t spec_info_idx_; ///< id of the CommonSpecInfo_t associated to this WorkNode in WorkNode::SpecInfos
+  ThreadPoolHandler<PosStep, F, Ti, ArgT...> *tph_; ///< Execution of the loop this WorkNode belongs to
+  size_t spec_info_idx_; ///< id of the CommonSpecInfo_t associated to this WorkNode in ThreadPoolHandler::spec_infos_
   volatile size_t paral_threads_; ///< \# threads for the parallel execution of the chunk, without the sequential one
   Ti begin_, end_;
   size_t grain_, grainD_, grainM_;
+  std::atomic<size_t> next_iter_; ///< First iteration of the parallel part not claimed yet in the dynamic distribution
   volatile bool seq_valid; ///< indicates if the execution of the sequential part has finished before the parallel part
+  bool repair_; ///< The chunk started from speculated values that only differ from the true ones in SpecRepairables, to repair in its validation
+  bool doall_; ///< The chunk skips its sequential run, and the thread that would run it takes a portion of its parallel part instead
+  bool probe_; ///< The chunk keeps its sequential run to check for dependences while the rest skip it, so any mismatch rolls the loop back
+  RepairStarts_t repair_starts_; ///< True and speculated starts of the SpecRepairables when ::repair_ is set
   ChunkVals_t<ArgT...> chunk_vals_;
+  std::vector<std::pair<Ti, TupleVal_t>> checkpoints_; ///< Snapshots of the sequential run and the iterations where they were taken
   std::atomic<size_t> in_threads_; ///< \# threads that started the seq (first one) + parallel execution
   std::atomic<size_t> out_threads_; ///< \# threads that finished the parallel execution
+  std::atomic<size_t> reduced_threads_; ///< \# threads that published the partial results of their ReductionVars in the parallel execution
   std::atomic<int> validation_state_; /**< Number of events before validation is run. They are
                                        always the sequential run + (the creation of the next chunk
                                        or the final wait on the last chunk). In speculative chunks
@@ -207,97 +339,25 @@ class WorkNode {
 
   WorkNode *next; //< Pointer to the next ::WorkNode
 
-  static std::array<std::atomic<std::uintptr_t>, 2> SpecInfos_sync; /**< Synchronization array for the 2 SpecInfos that allows to ensure
-                                                                     that they are no longer in use when they are going to be reset
-                                                                   */
-  static LinkedListPool<WorkNode<PosStep, F, Ti, ArgT...>> Pool;
-  static ThreadPoolHandler<PosStep, F, Ti, ArgT...> *TPH;
-  static CommonSpecInfo_t SpecInfos[2]; /**< There are at most 2 SpecInfos alive at a given point:
-                                         One associated to a failed speculation, and another one
-                                         associated to the subsequent chunks restarted from that point.
-                                       */
-  static size_t CurrSpecInfoIdx; ///< Currently active CommonSpecInfo_t in WorkNode::SpecInfos
-  static Ti Step;
-  static Ti End;
-  static size_t Absolute_chunk_size;
-
 #if defined(SLSTATS) || defined(SLMINIMALSTATS)
   struct StatsRunInfoInternal {
     unsigned long long int successes = 0;
     unsigned long long int failures = 0;
     unsigned long long int sequential = 0;
+    unsigned long long int salvaged = 0;
     StatsProfileTimers pt;
 
     void reset() noexcept {
       successes = 0;
       failures = 0;
       sequential = 0;
+      salvaged = 0;
       pt.reset();
     }
   };
 
-public:
-  static std::mutex statsMutex;
-  static StatsRunInfoInternal statsRT;
   static thread_local StatsRunInfoInternal statsR;
-private:
-#endif
-
-#ifdef SLSIMULATE
-public:
-  static bool simulate_mode;
-  static float simulate_ratio_successes;
-private:
-#endif
-
-  static CommonSpecInfo_t& CurrentSpecInfo() noexcept { return SpecInfos[CurrSpecInfoIdx]; }
-
-  static void PrepareSpecInfo(ThreadPoolHandler<PosStep, F, Ti, ArgT...> * const tph, const Ti step, const Ti end, const size_t absolute_chunk_size) noexcept
-  {
-    TPH = tph;
-    CurrSpecInfoIdx = 0;
-    CurrentSpecInfo().reset(TPH->nthreads() + 1);
-    SpecInfos_sync[0].store(static_cast<std::uintptr_t>(0u), std::memory_order_relaxed);
-    SpecInfos_sync[1].store(static_cast<std::uintptr_t>(0u), std::memory_order_relaxed);
-    Step = step;
-    End = end;
-    Absolute_chunk_size = absolute_chunk_size;
-#if defined(SLSTATS) || defined(SLMINIMALSTATS)
-    statsR.reset();
-    statsRT.reset();
-#endif
-  }
-
-  static void RecoverFromFailure(WorkNode * const curr_head)
-  {
-#ifdef SLSTATS
-    const profile_clock_t::time_point t0 = profile_clock_t::now();
-#endif
-    assert(curr_head != nullptr);
-    WorkNode * const last_correct_chunk = reinterpret_cast<WorkNode *>(CurrentSpecInfo().cancelled_node());
-    assert(curr_head != last_correct_chunk);
-#ifdef SLSTATS
-    const profile_clock_t::time_point t1 = profile_clock_t::now();
-#endif
-    curr_head->trigger_validation();
-#ifdef SLSTATS
-    const profile_clock_t::time_point t2 = profile_clock_t::now();
-#endif
-    while(SpecInfos_sync[1u - CurrSpecInfoIdx]);
-    CurrSpecInfoIdx = 1u - CurrSpecInfoIdx;
-    CurrentSpecInfo().reset(TPH->nthreads() + 1);
-    WorkNode * const new_head = Pool.defaultmalloc();
-#ifdef SLSTATS
-    const profile_clock_t::time_point t3 = profile_clock_t::now();
-#endif
-    new_head->fill(last_correct_chunk, false);
-    while (last_correct_chunk->validation_state_.load(std::memory_order_relaxed) == 0);
-    last_correct_chunk->free();
-#ifdef SLSTATS
-    const profile_clock_t::time_point t4 = profile_clock_t::now();
-    statsR.pt.gwtimeOF += std::chrono::duration<double>(t1 - t0).count() + std::chrono::duration<double>(t3 - t2).count() + std::chrono::duration<double>(t4 - new_head->wts5).count();
 #endif
-  }
 
   template<std::size_t... Is>
   static void copy_back_array_chunks_helper(const TupleVal_t& v, std::index_sequence<Is...>)
@@ -323,6 +383,18 @@ private:
     reduce_ReductionVars_helper(v, std::index_sequence_for<ArgT...>{});
   }
 
+  template<std::size_t... Is>
+  static void collect_ReductionVars_helper(TupleVal_t& v, std::index_sequence<Is...>)
+  {
+    (void)std::initializer_list<int>{(collect_if_ReductionVar(std::get<Is>(v)), 0)...};
+  }
+
+  /// Folds into ReductionVars the partial results published by reduce_ReductionVars
+  static inline void collect_ReductionVars(TupleVal_t& v)
+  {
+    collect_ReductionVars_helper(v, std::index_sequence_for<ArgT...>{});
+  }
+
   template<std::size_t... Is>
   static void initialize_ReductionVars_helper(TupleVal_t& v, std::index_sequence<Is...>)
   {
@@ -335,6 +407,97 @@ private:
     initialize_ReductionVars_helper(v, std::index_sequence_for<ArgT...>{});
   }
 
+  template<std::size_t... Is>
+  static void start_SpecPredicteds_helper(TupleVal_t& v, const Ti begin, std::index_sequence<Is...>)
+  {
+    (void)std::initializer_list<int>{(start_if_SpecPredicted(std::get<Is>(v), static_cast<long long>(begin)), 0)...};
+  }
+
+  /// Invokes start() on SpecPredicteds
+  static inline void start_SpecPredicteds(TupleVal_t& v, const Ti begin)
+  {
+    start_SpecPredicteds_helper(v, begin, std::index_sequence_for<ArgT...>{});
+  }
+
+  template<std::size_t... Is>
+  static void record_SpecPredicteds_helper(TupleVal_t& v, const Ti iteration, std::index_sequence<Is...>)
+  {
+    (void)std::initializer_list<int>{(record_if_SpecPredicted(std::get<Is>(v), static_cast<long long>(iteration)), 0)...};
+  }
+
+  /// Invokes record() on SpecPredicteds
+  static inline void record_SpecPredicteds(TupleVal_t& v, const Ti iteration)
+  {
+    record_SpecPredicteds_helper(v, iteration, std::index_sequence_for<ArgT...>{});
+  }
+
+  template<std::size_t... Is>
+  static void predict_SpecPredicteds_helper(TupleVal_t& v, const Ti iteration, std::index_sequence<Is...>)
+  {
+    (void)std::initializer_list<int>{(predict_if_SpecPredicted(std::get<Is>(v), static_cast<long long>(iteration)), 0)...};
+  }
+
+  /// Invokes predict() on SpecPredicteds
+  static inline void predict_SpecPredicteds(TupleVal_t& v, const Ti iteration)
+  {
+    predict_SpecPredicteds_helper(v, iteration, std::index_sequence_for<ArgT...>{});
+  }
+
+  template<std::size_t... Is>
+  static bool loop_exited_helper(const TupleVal_t& v, std::index_sequence<Is...>)
+  { bool ret = false;
+
+    (void)std::initializer_list<int>{(ret = exited_if_LoopExit(std::get<Is>(v)) || ret, 0)...};
+    return ret;
+  }
+
+  /// Whether the values \c v are past the end of a loop run by ::specWhile
+  static inline bool loop_exited(const TupleVal_t& v)
+  {
+    return loop_exited_helper(v, std::index_sequence_for<ArgT...>{});
+  }
+
+  template<std::size_t... Is>
+  bool repairable_mismatch_helper(RepairStarts_t& starts, std::index_sequence<Is...>) const
+  { bool ret = true;
+
+    (void)std::initializer_list<int>{(ret = match_or_repairable(std::get<Is>(chunk_vals_.seqVals_), std::get<Is>(chunk_vals_.specVals_), std::get<Is>(starts)) && ret, 0)...};
+    return ret;
+  }
+
+  /// Lets the next chunk, which started from the mismatching speculated values, be kept and repaired if they only differ in SpecRepairables
+  bool repair_next(std::true_type)
+  {
+    if ((next != nullptr) && repairable_mismatch_helper(next->repair_starts_, std::index_sequence_for<ArgT...>{})) {
+      next->repair_ = true;
+      return true;
+    }
+    return false;
+  }
+
+  /// There are no SpecRepairables, so a mismatch always requires to rerun the next chunk
+  bool repair_next(std::false_type) const noexcept
+  {
+    return false;
+  }
+
+  bool repair_next()
+  {
+    return repair_next(AnyRepairable<ArgT...>{});
+  }
+
+  template<std::size_t... Is>
+  static void repair_SpecRepairables_helper(TupleVal_t& v, const RepairStarts_t& starts, std::index_sequence<Is...>)
+  {
+    (void)std::initializer_list<int>{(repair_if_SpecRepairable(std::get<Is>(v), std::get<Is>(starts)), 0)...};
+  }
+
+  /// Repairs the SpecRepairables in \c v with the true and speculated \c starts of the chunk
+  static inline void repair_SpecRepairables(TupleVal_t& v, const RepairStarts_t& starts)
+  {
+    repair_SpecRepairables_helper(v, starts, std::index_sequence_for<ArgT...>{});
+  }
+
   template<std::size_t... Is>
   static void unlink_SpecVectors_helper(TupleVal_t& v, std::index_sequence<Is...>)
   {
@@ -374,9 +537,8 @@ private:
   }
 
   template<typename F2, std::size_t... Is>
-  static std::enable_if_t<!Deduct_ExCommonSpecInfo_t<F2>::type::value> apply_helper(const Ti begin, const Ti end, const F2& f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args, std::index_sequence<Is...>)
+  static std::enable_if_t<!Deduct_ExCommonSpecInfo_t<F2>::type::value> apply_helper(const Ti begin, const Ti end, const Ti step, const F2& f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args, std::index_sequence<Is...>)
   {
-    const Ti step = Step;
 #if __cplusplus >= 201703L
     if constexpr(PosStep) {
 #else
@@ -393,54 +555,62 @@ private:
   }
 
   template<typename F2, std::size_t... Is>
-  static std::enable_if_t<Deduct_ExCommonSpecInfo_t<F2>::type::value> apply_helper(const Ti begin, const Ti end, const F2& f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args, std::index_sequence<Is...>)
+  static std::enable_if_t<Deduct_ExCommonSpecInfo_t<F2>::type::value> apply_helper(const Ti begin, const Ti end, const Ti step, const F2& f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args, std::index_sequence<Is...>)
   {
-    f(exspec_info, begin, end, Step, std::get<Is>(args)...);
+    f(exspec_info, begin, end, step, std::get<Is>(args)...);
   }
 
-  /// Run iterations \c begin to \c end for function \c f on the arguments \c args
-  static inline void apply(const Ti begin, const Ti end, const F&f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args)
+  /// Run iterations \c begin to \c end with step \c step for function \c f on the arguments \c args
+  /** \c exspec_info is the parent of the speculative loops that \c f may run */
+  static inline void apply(const Ti begin, const Ti end, const Ti step, const F&f, const ExCommonSpecInfo_t& exspec_info, std::tuple<ArgT...>& args)
   {
-    apply_helper(begin, end, f, exspec_info, args, std::index_sequence_for<ArgT...>{});
+    const ExCommonSpecInfo_t *& current = CurrentExSpecInfo();
+    const ExCommonSpecInfo_t * const enclosing = current;
+    current = &exspec_info;
+    apply_helper(begin, end, step, f, exspec_info, args, std::index_sequence_for<ArgT...>{});
+    current = enclosing;
   }
 
-  /// Computes the length of the speculative chunk that starts at \c begin
-  static inline size_t spec_size(const Ti begin) noexcept { return ((PosStep) ? static_cast<size_t>(std::min(End, begin + static_cast<Ti>(Absolute_chunk_size)) - begin) : static_cast<size_t>(begin - std::max(End, begin - static_cast<Ti>(Absolute_chunk_size)))); }
-
   bool enabled() const noexcept { return !(in_threads_.load(std::memory_order_relaxed) & Disabled); }
 
-  void common_fill(Ti begin, const int validation_state, const int pre_val_state)
+  /// Number of portions of the parallel part of the chunk
+  size_t portions() const noexcept { return paral_threads_ + doall_; }
+
+  void common_fill(Ti begin, const size_t size, const int validation_state, const int pre_val_state)
   {
     assert(!enabled());
     chunk_vals_.specVals_ = chunk_vals_.seqVals_;
-    spec_info_idx_ = CurrSpecInfoIdx;
-    const size_t available_paral_threads = CurrentSpecInfo().nthreads_.load(std::memory_order_relaxed) - 1;
-    paral_threads_ = std::max(available_paral_threads, TPH->min_paral_nthreads());
+    spec_info_idx_ = tph_->curr_spec_info_idx_;
+    const size_t available_paral_threads = tph_->CurrentSpecInfo().nthreads_.load(std::memory_order_relaxed) - 1;
+    paral_threads_ = std::max(available_paral_threads, tph_->min_paral_nthreads());
     begin_ = begin;
-    end_ = (PosStep) ? (std::min(End, begin + static_cast<Ti>(Absolute_chunk_size))) : (std::max(End, begin - static_cast<Ti>(Absolute_chunk_size)));
-    grain_ = static_cast<size_t>((PosStep) ? ((end_ - begin_ + Step - 1) / Step) : ((end_ - begin_ + Step + 1) / Step));
-    grainD_ = (grain_ / paral_threads_);
-    grainM_ = (grain_ % paral_threads_);
+    end_ = (PosStep) ? (begin + static_cast<Ti>(size)) : (begin - static_cast<Ti>(size));
+    grain_ = static_cast<size_t>((PosStep) ? ((end_ - begin_ + tph_->step_ - 1) / tph_->step_) : ((end_ - begin_ + tph_->step_ + 1) / tph_->step_));
+    grainD_ = (grain_ / portions());
+    grainM_ = (grain_ % portions());
+    next_iter_.store(0, std::memory_order_relaxed);
     seq_valid = false;
-    out_threads_.store(1);
+    repair_ = false;
+    out_threads_.store(doall_ ? 0 : 1);
+    reduced_threads_.store(0, std::memory_order_relaxed);
     validation_state_.store(validation_state);
     pre_val_state_ = pre_val_state;
 #ifdef THREADINSTRUMENT
     forced_parallelization_ = (paral_threads_ > available_paral_threads);
 #endif
     next = nullptr;
-    SpecInfos_sync[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
+    tph_->spec_infos_sync_[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
 #ifdef SLSTATS
     wts5adj = 0.0;
     wtimeW6 = 0.0;
     wtimeW1o = 0.0;
-    awt2.resize(paral_threads_);
-    awt3.resize(paral_threads_);
-    awt4.resize(paral_threads_);
-    wtimeOP.resize(paral_threads_);
-    wtimeRP.resize(paral_threads_);
-    wtimeOW.resize(paral_threads_);
-    wtimeW1.resize(paral_threads_);
+    awt2.resize(portions());
+    awt3.resize(portions());
+    awt4.resize(portions());
+    wtimeOP.resize(portions());
+    wtimeRP.resize(portions());
+    wtimeOW.resize(portions());
+    wtimeW1.resize(portions());
 #endif
   }
 
@@ -449,13 +619,16 @@ private:
   {
     pre_push_chunk();
     in_threads_.store(0); // enables the WorkNode
-    TPH->push_chunk(this);
+    tph_->push_chunk(this);
     post_push_chunk();
   }
 
   void pre_push_chunk()
   {
-    CurrentSpecInfo().nthreads_.fetch_sub(1);
+    if (!doall_) { // a thread is kept for the sequential run until it finishes
+      tph_->seq_in_flight_.fetch_add(1, std::memory_order_relaxed);
+      tph_->CurrentSpecInfo().nthreads_.fetch_sub(1);
+    }
   }
 
   void post_push_chunk()
@@ -463,14 +636,23 @@ private:
     paral_run(static_cast<size_t>(0)); // Runs the first parallel portion of the chunk
 
     // Wait for the other parallel threads to finish their portion of the chunk (doing work if that can help)
+    size_t polls = 0;
     while (out_threads_.load(std::memory_order_relaxed) < (paral_threads_+1)) {
       const size_t aux_n = in_threads_.load(std::memory_order_relaxed);
-      if (aux_n < paral_threads_ && aux_n) {
+      // the sequential run is left to the workers, but in DOALL chunks the first slot is just another portion
+      if (aux_n < paral_threads_ && (aux_n || doall_)) {
+        polls = 0;
 #ifdef SLSTATS
         const profile_clock_t::time_point t0 = profile_clock_t::now();
 #endif
         const size_t my_n = in_threads_.fetch_add(1);
-        if (my_n && my_n < paral_threads_) {
+        if (!my_n) {
+#ifdef SLSTATS
+          seq_run(t0);
+#else
+          seq_run();
+#endif
+        } else if (my_n < paral_threads_) {
 #ifdef SLSTATS
           awt2[my_n] = t0;
           wtimeW1[my_n] = 0.0;
@@ -482,6 +664,8 @@ private:
           wts5adj += std::chrono::duration<double>(t1 - t0).count();
 #endif
         }
+      } else {
+        tph_->backoff(polls++);
       }
     }
 #ifdef SLSTATS
@@ -489,9 +673,13 @@ private:
       aux_statstiming_flag = 0;
     }
 #endif
+    if (doall_) { // the parallel results stand for the sequential ones, which are not computed
+      chunk_vals_.seqVals_ = chunk_vals_.specVals_;
+      trigger_validation();
+    }
   }
 
-  CommonSpecInfo_t& mySpecInfo() const noexcept { return SpecInfos[spec_info_idx_]; }
+  CommonSpecInfo_t& mySpecInfo() const noexcept { return tph_->spec_infos_[spec_info_idx_]; }
 
 #ifdef SLSTATS
   void slstats_gather(const bool failed_val) {
@@ -548,7 +736,13 @@ private:
 #ifdef SLSTATS
         prefailed = false;
 #endif
+        if (repair_) {
+          // The next chunk started from the values before the repair, so they must be compared
+          repair_SpecRepairables(chunk_vals_.seqVals_, repair_starts_);
+          seq_valid = false;
+        }
         copy_back_array_chunks(chunk_vals_.seqVals_);
+        record_SpecPredicteds(chunk_vals_.seqVals_, end_);
 
         // The last validation is always successful because the seqVals_
         //were obtained from previously correct speculated values anyway
@@ -557,21 +751,42 @@ private:
           ++statsR.sequential;
 #endif
 #ifdef SLSIMULATE
-        } else if (((PosStep) ? (end_ < End) : (end_ > End)) && ((simulate_mode && (real_rand_gen() >= simulate_ratio_successes)) || (!simulate_mode && (chunk_vals_.seqVals_ != chunk_vals_.specVals_)))) {
+        } else if ((!doall_ || repair_) && ((PosStep) ? (end_ < tph_->end_) : (end_ > tph_->end_)) && ((tph_->simulate_mode_ && (real_rand_gen() >= tph_->simulate_ratio_successes_)) || (!tph_->simulate_mode_ && (chunk_vals_.seqVals_ != chunk_vals_.specVals_) && (probe_ || !repair_next())))) {
 #else
-        } else if (((PosStep) ? (end_ < End) : (end_ > End)) && (chunk_vals_.seqVals_ != chunk_vals_.specVals_)) {
+        } else if ((!doall_ || repair_) && ((PosStep) ? (end_ < tph_->end_) : (end_ > tph_->end_)) && (chunk_vals_.seqVals_ != chunk_vals_.specVals_) && (probe_ || !repair_next())) {
 #endif
+          // Chunks that skipped their sequential run are only compared if they were repaired. A mismatch in a probe
+          //is a dependence that the chunks that skipped it may also have, so it is never repaired, and the loop rolls back
           myspecinfo.cancel(this);
+          tph_->reset_salvage(end_);
+          tph_->chunk_size_.failure();
+          tph_->fallback_.failure();
+          tph_->memo_outcome(true);
+          tph_->doall_failure();
 #if defined(SLSTATS) || defined(SLMINIMALSTATS)
           ++statsR.failures;
+#endif
         } else {
+          tph_->chunk_size_.success();
+          tph_->fallback_.success();
+          tph_->memo_outcome(false);
+          if (!doall_) {
+            tph_->doall_success(end_, chunk_vals_.seqVals_, (next != nullptr) && next->repair_);
+          }
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
           ++statsR.successes;
 #endif
         }
-#ifdef SLSTATS
+        if (loop_exited(chunk_vals_.seqVals_)) {
+          tph_->exited_.store(true, std::memory_order_release);
+        }
       } else {
+#ifdef SLSTATS
         prefailed = true;
 #endif
+        if (!checkpoints_.empty()) {
+          tph_->store_salvage(begin_, checkpoints_);
+        }
       }
 #ifdef THREADINSTRUMENT
       ThreadInstrument::log(VERIFY, END, true);
@@ -592,17 +807,18 @@ private:
       }
 
       const auto cancelled_ptr = reinterpret_cast<WorkNode *>(myspecinfo.cancelled_node());
-      if( ( ((PosStep) ? (end_ < End) : (end_ > End)) && (cancelled_ptr != this) ) ||
-//          ( ((PosStep) ? (end_ >= End) : (end_ == End)) && (cancelled_ptr != nullptr) ) ) {
-          ( ((PosStep) ? (end_ >= End) : (end_ <= End)) && (cancelled_ptr != nullptr) ) ) {
-        SpecInfos_sync[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
+      const Ti loop_end = tph_->end_;
+      if( ( ((PosStep) ? (end_ < loop_end) : (end_ > loop_end)) && (cancelled_ptr != this) ) ||
+//          ( ((PosStep) ? (end_ >= loop_end) : (end_ == loop_end)) && (cancelled_ptr != nullptr) ) ) {
+          ( ((PosStep) ? (end_ >= loop_end) : (end_ <= loop_end)) && (cancelled_ptr != nullptr) ) ) {
+        tph_->spec_infos_sync_[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
 #ifdef SLSTATS
         wtv3 = profile_clock_t::now();
         slstats_gather(prefailed);
 #endif
         free();
       } else {
-        SpecInfos_sync[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
+        tph_->spec_infos_sync_[spec_info_idx_].fetch_xor(reinterpret_cast<std::uintptr_t>(this), std::memory_order_relaxed);
         validation_state_.store(-1); // signal RecoverFromFailure that it can free this
 #ifdef SLSTATS
         wtv3 = profile_clock_t::now();
@@ -613,11 +829,12 @@ private:
   }
 
   friend class ThreadPoolHandler<PosStep, F, Ti, ArgT...>;
-  friend class LinkedListPool<WorkNode<PosStep, F, Ti, ArgT...>>;
+  friend class LinkedListPool<WorkNode<PosStep, F, Ti, ArgT...>, NodeLocalAllocator_t>;
 
 public:
 
   WorkNode() :
+  tph_{nullptr},
   spec_info_idx_{0},
   paral_threads_{0},
   begin_{0},
@@ -625,28 +842,59 @@ public:
   grain_{0},
   grainD_{0},
   grainM_{0},
+  next_iter_{0},
   seq_valid{false},
+  repair_{false},
+  doall_{false},
+  probe_{false},
   in_threads_{Disabled},
   out_threads_{1},
+  reduced_threads_{0},
   validation_state_{0},
   pre_val_state_{0},
   next{nullptr}
   { }
 
+  /// Prepares for a new use a node kept constructed in its pool, preserving the buffers of its values
+  void reset() noexcept
+  {
+    tph_ = nullptr;
+    spec_info_idx_ = 0;
+    paral_threads_ = 0;
+    begin_ = end_ = 0;
+    grain_ = grainD_ = grainM_ = 0;
+    next_iter_.store(0, std::memory_order_relaxed);
+    seq_valid = false;
+    repair_ = false;
+    doall_ = probe_ = false;
+    in_threads_.store(Disabled, std::memory_order_relaxed);
+    out_threads_.store(1, std::memory_order_relaxed);
+    reduced_threads_.store(0, std::memory_order_relaxed);
+    validation_state_.store(0, std::memory_order_relaxed);
+    pre_val_state_ = 0;
+    next = nullptr;
+  }
+
   // Only used for the first chunk
   template<typename... ArgT2>
-  void fill(Ti begin, ArgT2&&... args)
+  void fill(ThreadPoolHandler<PosStep, F, Ti, ArgT...> * const tph, Ti begin, ArgT2&&... args)
   {
+    tph_ = tph;
+    doall_ = probe_ = false;
 #ifndef SLSTATS
-    chunk_vals_.seqVals_ = TupleVal_t(spec_version<PosStep>(args, begin, spec_size(begin))...);
+    const size_t size = tph_->spec_size(begin);
+    chunk_vals_.seqVals_ = TupleVal_t(spec_version<PosStep>(args, begin, size)...);
     unlink_SpecVectors(chunk_vals_.seqVals_);
-    common_fill(begin, 2, 0);
+    start_SpecPredicteds(chunk_vals_.seqVals_, begin);
+    common_fill(begin, size, 2, 0);
     push_process();
 #else
     wts0 = profile_clock_t::now();
-    chunk_vals_.seqVals_ = TupleVal_t(spec_version<PosStep>(args, begin, spec_size(begin))...);
+    const size_t size = tph_->spec_size(begin);
+    chunk_vals_.seqVals_ = TupleVal_t(spec_version<PosStep>(args, begin, size)...);
     unlink_SpecVectors(chunk_vals_.seqVals_);
-    common_fill(begin, 2, 0);
+    start_SpecPredicteds(chunk_vals_.seqVals_, begin);
+    common_fill(begin, size, 2, 0);
     awt2[0] = wts0;
     push_process();
     wts5 = profile_clock_t::now();
@@ -656,12 +904,20 @@ public:
 
   void fill(WorkNode* const prev, const bool from_speculative)
   {
+    tph_ = prev->tph_;
+    tph_->doall_roles(from_speculative, doall_, probe_);
 #ifndef SLSTATS
-    fill_next_val(from_speculative ? prev->chunk_vals_.specVals_ : prev->chunk_vals_.seqVals_, prev->end_, spec_size(prev->end_));
+    const size_t size = tph_->spec_size(prev->end_);
+    if (from_speculative && !prev->seq_valid && !prev->doall_) {
+      // The validation of prev compares its sequential results with the prediction. When its sequential
+      //run finished first, or it was skipped, the validation compares nothing
+      predict_SpecPredicteds(prev->chunk_vals_.specVals_, prev->end_);
+    }
+    fill_next_val(from_speculative ? prev->chunk_vals_.specVals_ : prev->chunk_vals_.seqVals_, prev->end_, size);
     if (!from_speculative) {
       unlink_SpecVectors(chunk_vals_.seqVals_);
     }
-    common_fill(prev->end_, 2 + from_speculative, 1 + from_speculative);
+    common_fill(prev->end_, size, 2 + from_speculative, 1 + from_speculative);
     if (from_speculative) {
       prev->next = this;
       prev->trigger_validation();
@@ -669,11 +925,17 @@ public:
     push_process();
 #else
     wts0 = profile_clock_t::now();
-    fill_next_val(from_speculative ? prev->chunk_vals_.specVals_ : prev->chunk_vals_.seqVals_, prev->end_, spec_size(prev->end_));
+    const size_t size = tph_->spec_size(prev->end_);
+    if (from_speculative && !prev->seq_valid && !prev->doall_) {
+      // The validation of prev compares its sequential results with the prediction. When its sequential
+      //run finished first, or it was skipped, the validation compares nothing
+      predict_SpecPredicteds(prev->chunk_vals_.specVals_, prev->end_);
+    }
+    fill_next_val(from_speculative ? prev->chunk_vals_.specVals_ : prev->chunk_vals_.seqVals_, prev->end_, size);
     if (!from_speculative) {
       unlink_SpecVectors(chunk_vals_.seqVals_);
     }
-    common_fill(prev->end_, 2 + from_speculative, 1 + from_speculative);
+    common_fill(prev->end_, size, 2 + from_speculative, 1 + from_speculative);
     if (from_speculative) {
       prev->next = this;
       wts1 = profile_clock_t::now();
@@ -691,6 +953,90 @@ public:
 #endif
   }
 
+  /// Runs the first \c size iterations of the loop sequentially in the calling thread, which has no threads to speculate with
+  /** The chunk is not pushed to the workers and it is left as if its sequential run had finished */
+  template<typename... ArgT2>
+  void fill_sequential(ThreadPoolHandler<PosStep, F, Ti, ArgT...> * const tph, Ti begin, const size_t size, ArgT2&&... args)
+  {
+    tph_ = tph;
+    doall_ = probe_ = false;
+#ifdef SLSTATS
+    wts0 = profile_clock_t::now();
+#endif
+    chunk_vals_.seqVals_ = TupleVal_t(spec_version<PosStep>(args, begin, size)...);
+    unlink_SpecVectors(chunk_vals_.seqVals_);
+    start_SpecPredicteds(chunk_vals_.seqVals_, begin);
+    common_fill(begin, size, 2, 0);
+    sequential_run();
+  }
+
+  /// Restarts the loop at \c begin from the values \c vals, known to be correct
+  void restart(ThreadPoolHandler<PosStep, F, Ti, ArgT...> * const tph, const Ti begin, const TupleVal_t& vals)
+  {
+    tph_ = tph;
+    doall_ = probe_ = false;
+#ifdef SLSTATS
+    wts0 = profile_clock_t::now();
+#endif
+    const size_t size = tph_->spec_size(begin);
+    fill_next_val(vals, begin, size);
+    unlink_SpecVectors(chunk_vals_.seqVals_);
+    common_fill(begin, size, 2, 1);
+#ifndef SLSTATS
+    push_process();
+#else
+    awt2[0] = wts0;
+    push_process();
+    wts5 = profile_clock_t::now();
+    wtimeOW[0] = std::chrono::duration<double>(wts5-awt4[0]).count() - wts5adj;
+#endif
+  }
+
+  /// Runs the \c size iterations that follow \c prev, a correct chunk, sequentially in the calling thread
+  /** The chunk is not pushed to the workers and it is left as if its sequential run had finished */
+  void fill_sequential(WorkNode* const prev, const size_t size)
+  {
+    tph_ = prev->tph_;
+    doall_ = probe_ = false;
+#ifdef SLSTATS
+    wts0 = profile_clock_t::now();
+#endif
+    fill_next_val(prev->chunk_vals_.seqVals_, prev->end_, size);
+    unlink_SpecVectors(chunk_vals_.seqVals_);
+    common_fill(prev->end_, size, 2, 1);
+    sequential_run();
+  }
+
+  /// Runs the chunk, already filled, sequentially in the calling thread
+  void sequential_run()
+  {
+#ifdef SLSTATS
+    std::fill(wtimeOP.begin(), wtimeOP.end(), 0.0);
+    std::fill(wtimeRP.begin(), wtimeRP.end(), 0.0);
+    std::fill(wtimeOW.begin(), wtimeOW.end(), 0.0);
+    std::fill(wtimeW1.begin(), wtimeW1.end(), 0.0);
+    aux_statstiming_flag = 0;
+    wtimeOPs = 0.0;
+    wtimeOWs = 0.0;
+    wtp0 = profile_clock_t::now();
+#endif
+
+    const ExCommonSpecInfo_t exMySpecInfo(mySpecInfo(), false, false, tph_->parent_);
+    initialize_ReductionVars(chunk_vals_.seqVals_);
+    apply(begin_, end_, tph_->step_, tph_->f(), exMySpecInfo, chunk_vals_.seqVals_);
+    reduce_ReductionVars(chunk_vals_.seqVals_);
+    collect_ReductionVars(chunk_vals_.seqVals_);
+    chunk_vals_.specVals_ = chunk_vals_.seqVals_;
+    seq_valid = true;
+    tph_->head_ = this;
+#ifdef SLSTATS
+    wts5 = profile_clock_t::now();
+    wtimeRSs = std::chrono::duration<double>(wts5 - wtp0).count();
+#endif
+
+    trigger_validation();
+  }
+
   Ti begin() const noexcept { return begin_; }
 
   Ti end() const noexcept { return end_; }
@@ -702,29 +1048,45 @@ public:
   void seq_run()
 #endif
   {
+    if (doall_) { // the sequential run is skipped, and this thread takes the last portion of the parallel part
+#ifdef SLSTATS
+      awt2[paral_threads_] = t1;
+#endif
+      paral_run(paral_threads_);
+      return;
+    }
+
 #ifdef THREADINSTRUMENT
     const auto thread_instrument_code = forced_parallelization_ ? SEQCOMPF : SEQCOMP;
     ThreadInstrument::log(thread_instrument_code, (((int) begin_) << 1) | BEGIN, true);
 #endif
 
-    const ExCommonSpecInfo_t exMySpecInfo(mySpecInfo(), false, (pre_val_state_ >= 2));
+    const ExCommonSpecInfo_t exMySpecInfo(mySpecInfo(), false, (pre_val_state_ >= 2), tph_->parent_);
 #ifdef SLSTATS
     wtp0 = profile_clock_t::now();
 #endif
     initialize_ReductionVars(chunk_vals_.seqVals_);
-    apply(begin_, end_, TPH->f(), exMySpecInfo, chunk_vals_.seqVals_);
+    if (tph_->memo_capacity_) {
+      memoized_seq_apply(exMySpecInfo, AllCheckpointable<ArgT...>{});
+    } else {
+      seq_apply(exMySpecInfo);
+    }
     reduce_ReductionVars(chunk_vals_.seqVals_);
+    collect_ReductionVars(chunk_vals_.seqVals_);
 #ifdef SLSTATS
     wtp1 = profile_clock_t::now();
 #endif
 
     mySpecInfo().nthreads_.fetch_add(1);
+    tph_->seq_in_flight_.fetch_sub(1, std::memory_order_relaxed);
     if (!mySpecInfo().failed()) {
       if (out_threads_.load(std::memory_order_relaxed) < (paral_threads_+1)) {
         if (out_threads_.fetch_sub(1, std::memory_order_relaxed) < (paral_threads_+1)) {
           mySpecInfo().seq_cancel();
           seq_valid = true;
-          while (out_threads_.load(std::memory_order_relaxed) < paral_threads_);
+          for (size_t polls = 0; out_threads_.load(std::memory_order_relaxed) < paral_threads_; polls++) {
+            tph_->backoff(polls);
+          }
           mySpecInfo().end_seq_cancel();
           chunk_vals_.specVals_ = chunk_vals_.seqVals_;
         }
@@ -752,33 +1114,139 @@ public:
 
   }
 
-  /// Run a parallel portion of a chunk according to the number of \c thread
-  void paral_run(const size_t nthread)
+  /// Run iterations \c b to \c e, counted from the beginning of the chunk, of its parallel part
+  void paral_apply(const Ti b, const Ti e, const ExCommonSpecInfo_t& exMySpecInfo)
   {
-#ifdef THREADINSTRUMENT
-    const auto thread_instrument_code = forced_parallelization_ ? PARCOMPF : PARCOMP;
-    ThreadInstrument::log(thread_instrument_code, (((int) begin_) << 1) | BEGIN, true);
-#endif
-    const Ti b = (Ti) (nthread*(grainD_) + std::min(nthread, grainM_));
-    const Ti e = (Ti) ((nthread+1)*(grainD_) + std::min((nthread+1), grainM_));
+    const Ti step = tph_->step_;
+    const Ti loop_end = tph_->end_;
+    const Ti begin = (PosStep) ? std::min(loop_end, begin_ + b*step) : std::max(loop_end, begin_ + b*step);
+    const Ti end = (PosStep) ? std::min(loop_end, begin_ + e*step) : std::max(loop_end, begin_ + e*step);
 
-    const Ti begin = (PosStep) ? std::min(End, begin_ + b*Step) : std::max(End, begin_ + b*Step);
-    const Ti end = (PosStep) ? std::min(End, begin_ + e*Step) : std::max(End, begin_ + e*Step);
+    apply(begin, end, step, tph_->f(), exMySpecInfo, chunk_vals_.specVals_);
+  }
 
-#ifdef SLSTATS
-    awt3[nthread] = profile_clock_t::now();
-#endif
-    const ExCommonSpecInfo_t exMySpecInfo(mySpecInfo(), true, (pre_val_state_ >= 2));
-    initialize_ReductionVars(chunk_vals_.specVals_);
-    apply(begin, end, TPH->f(), exMySpecInfo, chunk_vals_.specVals_);
-    reduce_ReductionVars(chunk_vals_.specVals_);
+  /// Sequential run of the chunk, taking snapshots of its state if they are enabled
+  void seq_apply(const ExCommonSpecInfo_t& exMySpecInfo)
+  {
+    if (tph_->checkpoint_interval_) {
+      checkpointed_seq_apply(exMySpecInfo, AllCheckpointable<ArgT...>{});
+    } else {
+      apply(begin_, end_, tph_->step_, tph_->f(), exMySpecInfo, chunk_vals_.seqVals_);
+    }
+  }
 
-#ifdef SLSTATS
-    awt4[nthread] = profile_clock_t::now();
-    wtimeOP[nthread] = std::chrono::duration<double>(awt3[nthread] - awt2[nthread]).count();
-    wtimeRP[nthread] = std::chrono::duration<double>(awt4[nthread] - awt3[nthread]).count();
-#endif
-    out_threads_.fetch_add(1);
+  /// Sequential run of the chunk that reuses the result of a previous run of its iterations from the same state
+  /** Only the runs from speculated values can be discarded by the failed validation of a previous chunk
+      and rerun in the recovery, so only their results are remembered, and only while the loop has failed
+      recently. The rest of the runs do not copy their start state */
+  void memoized_seq_apply(const ExCommonSpecInfo_t& exMySpecInfo, std::true_type)
+  {
+    if (tph_->memo_lookup(begin_, end_, chunk_vals_.seqVals_)) {
+      checkpoints_.clear();
+      return;
+    }
+    if ((pre_val_state_ < 2) || !tph_->memo_unstable()) {
+      seq_apply(exMySpecInfo);
+      return;
+    }
+    TupleVal_t start = chunk_vals_.seqVals_;
+    seq_apply(exMySpecInfo);
+    if (!exMySpecInfo.cancelled()) { // only complete runs are remembered
+      tph_->memo_store(begin_, end_, start, chunk_vals_.seqVals_);
+    }
+  }
+
+  /// The states of some of the arguments cannot be copied and compared, so the results are not memoized
+  void memoized_seq_apply(const ExCommonSpecInfo_t& exMySpecInfo, std::false_type)
+  {
+    seq_apply(exMySpecInfo);
+  }
+
+  /// Sequential run of the chunk taking snapshots of its state periodically
+  /** When the chunk reruns, after a failed validation, the beginning of the chunk that was
+      cancelled, and its state matches a snapshot of that chunk, the run resumes from the most
+      advanced snapshot of the cancelled chunk that lies within this one */
+  void checkpointed_seq_apply(const ExCommonSpecInfo_t& exMySpecInfo, std::true_type)
+  {
+    const Ti step = tph_->step_;
+    const Ti span = static_cast<Ti>(tph_->checkpoint_interval_) * step;
+    bool may_resume = (pre_val_state_ == 1) && (begin_ == tph_->salvage_begin_.load());
+
+    checkpoints_.clear();
+    Ti b = begin_;
+    while (((PosStep) ? (b < end_) : (b > end_)) && !exMySpecInfo.cancelled()) {
+      const Ti e = (PosStep) ? std::min(end_, b + span) : std::max(end_, b + span);
+      apply(b, e, step, tph_->f(), exMySpecInfo, chunk_vals_.seqVals_);
+      if ((e == end_) || exMySpecInfo.cancelled()) {
+        break;
+      }
+      b = e;
+      checkpoints_.emplace_back(b, chunk_vals_.seqVals_);
+      if (may_resume && tph_->salvage_ready_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(tph_->salvage_mutex_);
+        const auto& salvage = tph_->salvage_;
+        const auto it = std::find_if(salvage.begin(), salvage.end(), [b](const std::pair<Ti, TupleVal_t>& p) { return p.first == b; });
+        if (it == salvage.end()) {
+          may_resume = false;
+        } else if (it->second == chunk_vals_.seqVals_) {
+          auto last = it;
+          while (((last + 1) != salvage.end()) && ((PosStep) ? ((last + 1)->first <= end_) : ((last + 1)->first >= end_))) {
+            ++last;
+          }
+          checkpoints_.insert(checkpoints_.end(), it + 1, last + 1);
+          chunk_vals_.seqVals_ = last->second;
+          b = last->first;
+          may_resume = false;
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+          ++statsR.salvaged;
+#endif
+        }
+      }
+    }
+  }
+
+  /// The states of some of the arguments cannot be snapshotted, so no checkpoints are taken
+  void checkpointed_seq_apply(const ExCommonSpecInfo_t& exMySpecInfo, std::false_type)
+  {
+    apply(begin_, end_, tph_->step_, tph_->f(), exMySpecInfo, chunk_vals_.seqVals_);
+  }
+
+  /// Run a parallel portion of a chunk according to the number of \c thread
+  /** In the dynamic distribution the portion consists of the blocks of iterations
+      that the thread claims until the parallel part is exhausted */
+  void paral_run(const size_t nthread)
+  {
+#ifdef THREADINSTRUMENT
+    const auto thread_instrument_code = forced_parallelization_ ? PARCOMPF : PARCOMP;
+    ThreadInstrument::log(thread_instrument_code, (((int) begin_) << 1) | BEGIN, true);
+#endif
+#ifdef SLSTATS
+    awt3[nthread] = profile_clock_t::now();
+#endif
+    const ExCommonSpecInfo_t exMySpecInfo(mySpecInfo(), true, (pre_val_state_ >= 2), tph_->parent_);
+    initialize_ReductionVars(chunk_vals_.specVals_);
+    const size_t block = tph_->dynamic_block_size_;
+    if (block) {
+      for (size_t b = next_iter_.fetch_add(block, std::memory_order_relaxed); (b < grain_) && !exMySpecInfo.cancelled(); b = next_iter_.fetch_add(block, std::memory_order_relaxed)) {
+        paral_apply((Ti) b, (Ti) std::min(b + block, grain_), exMySpecInfo);
+      }
+    } else {
+      const Ti b = (Ti) (nthread*(grainD_) + std::min(nthread, grainM_));
+      const Ti e = (Ti) ((nthread+1)*(grainD_) + std::min((nthread+1), grainM_));
+      paral_apply(b, e, exMySpecInfo);
+    }
+    reduce_ReductionVars(chunk_vals_.specVals_);
+    // The last thread to finish its portion folds the partial results of all of them before it is counted in out_threads_
+    if (reduced_threads_.fetch_add(1, std::memory_order_acq_rel) == (portions() - 1)) {
+      collect_ReductionVars(chunk_vals_.specVals_);
+    }
+
+#ifdef SLSTATS
+    awt4[nthread] = profile_clock_t::now();
+    wtimeOP[nthread] = std::chrono::duration<double>(awt3[nthread] - awt2[nthread]).count();
+    wtimeRP[nthread] = std::chrono::duration<double>(awt4[nthread] - awt3[nthread]).count();
+#endif
+    out_threads_.fetch_add(1);
 
 #ifdef THREADINSTRUMENT
     ThreadInstrument::log(thread_instrument_code, (((int) begin_) << 1) | END, true);
@@ -792,7 +1260,10 @@ public:
     const profile_clock_t::time_point t0 = profile_clock_t::now();
 #endif
 
-    while (!mySpecInfo().failed() && (validation_state_.load(std::memory_order_relaxed) > 1));
+    size_t polls = 0;
+    while (!mySpecInfo().failed() && (validation_state_.load(std::memory_order_relaxed) > 1)) {
+      tph_->relax(polls++);
+    }
 //    while (!mySpecInfo().failed() && (validation_state_.load(std::memory_order_relaxed) != 1));
 
     const bool was_failed = mySpecInfo().failed();
@@ -807,7 +1278,7 @@ public:
 #endif
 
     if (was_failed) {
-      RecoverFromFailure(this);
+      tph_->RecoverFromFailure();
     } else {
       trigger_validation();
     }
@@ -824,7 +1295,7 @@ public:
   void free() noexcept
   {
     in_threads_.store(Disabled); // disables WorkNode
-    Pool.free(this);
+    tph_->free_node(this);
   }
 
   ~WorkNode()
@@ -832,62 +1303,157 @@ public:
   
 };
 
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
 template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-LinkedListPool<WorkNode<PosStep, F, Ti, ArgT...>> WorkNode<PosStep, F, Ti, ArgT...>::Pool(4);
-
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-ThreadPoolHandler<PosStep, F, Ti, ArgT...> *WorkNode<PosStep, F, Ti, ArgT...>::TPH;
-
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-CommonSpecInfo_t WorkNode<PosStep, F, Ti, ArgT...>::SpecInfos[2];
+thread_local typename WorkNode<PosStep, F, Ti, ArgT...>::StatsRunInfoInternal WorkNode<PosStep, F, Ti, ArgT...>::statsR;
+#endif
 
 template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-std::array<std::atomic<std::uintptr_t>, 2> WorkNode<PosStep, F, Ti, ArgT...>::SpecInfos_sync;
+class ThreadPoolHandler {
+  using My_WorkNode_t = WorkNode<PosStep, F, Ti, ArgT...>;
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-size_t WorkNode<PosStep, F, Ti, ArgT...>::CurrSpecInfoIdx;
+  using TupleVal_t = typename ChunkVals_t<ArgT...>::TupleVal_t;
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-Ti WorkNode<PosStep, F, Ti, ArgT...>::Step;
+  /// Polls for another thread of the loop to finish a step of the execution before yielding the CPU between them
+  static constexpr size_t BackoffSpins = 64;
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-Ti WorkNode<PosStep, F, Ti, ArgT...>::End;
+  /// Result of ::claim when the thread got no portion of the chunk
+  static constexpr size_t NoPortion = ~static_cast<size_t>(0);
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-size_t WorkNode<PosStep, F, Ti, ArgT...>::Absolute_chunk_size;
+  /// Result of ::claim when the sequential run of the chunk is left to the thread dedicated to them
+  static constexpr size_t SeqLeft = NoPortion - 1;
 
-#if defined(SLSTATS) || defined(SLMINIMALSTATS)
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-thread_local typename WorkNode<PosStep, F, Ti, ArgT...>::StatsRunInfoInternal WorkNode<PosStep, F, Ti, ArgT...>::statsR;
-
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-typename WorkNode<PosStep, F, Ti, ArgT...>::StatsRunInfoInternal WorkNode<PosStep, F, Ti, ArgT...>::statsRT;
+  const ExCommonSpecInfo_t * const parent_; ///< Execution of the enclosing speculative loop for nested loops, nullptr otherwise
+  size_t nthreads_; ///< Number of threads of the pool that participate in the execution, without the main one
+  const size_t min_paral_nthreads_;
+  const size_t dynamic_block_size_; ///< Iterations claimed at a time in the parallel part of the chunks, 0 for a static distribution
+  const size_t max_spec_depth_; ///< Maximum number of chunks with their sequential run in flight, 0 for no limit
+  std::atomic<size_t> seq_in_flight_; ///< Number of chunks pushed whose sequential run has not finished yet
+  const size_t idle_spins_;  ///< Busy polls for work before yielding the CPU
+  const size_t idle_yields_; ///< Polls for work yielding the CPU before blocking
+  std::atomic<size_t> push_count_; ///< Number of chunks pushed, used to wake up blocked threads
+  std::atomic<size_t> parked_; ///< Number of threads blocked waiting for a new chunk
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_var_;
+  const TopologyPlacementGuard_t topology_placement_; ///< Placement according to the topology of the machine, if this loop holds it
+  std::vector<int> cpus_; ///< CPUs to pin the threads to, in order, or empty to leave them unpinned
+  int seq_cpu_; ///< CPU of the thread dedicated to the sequential runs of the chunks, whose physical core the rest do not use. -1 if none
+  std::atomic<bool> seq_thread_waiting_; ///< Whether the thread dedicated to the sequential runs is polling for one, so the rest leave them to it
+  const size_t checkpoint_interval_; ///< Iterations between snapshots of the sequential runs, 0 if they are not taken
+  std::vector<std::pair<Ti, TupleVal_t>> salvage_; ///< Snapshots of the chunk cancelled by the last failed validation
+  std::atomic<Ti> salvage_begin_; ///< Beginning of the chunk cancelled by the last failed validation
+  std::atomic<bool> salvage_ready_; ///< Whether ::salvage_ holds the snapshots of that chunk
+  std::mutex salvage_mutex_;
+
+  /// Result of a complete sequential run of a chunk from a given state
+  struct MemoEntry_t {
+    Ti begin_, end_;
+    TupleVal_t start_, result_;
+  };
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-std::mutex WorkNode<PosStep, F, Ti, ArgT...>::statsMutex;
-#endif
+  /// Maximum number of results of sequential runs remembered in a bucket of the memoization table
+  static constexpr size_t MemoWays = 4;
 
-#ifdef SLSIMULATE
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-bool WorkNode<PosStep, F, Ti, ArgT...>::simulate_mode;
+  /// Results of sequential runs of the chunks whose ranges map to the same bucket, replaced in FIFO order when it is full
+  struct MemoBucket_t {
+    std::atomic<bool> busy_;    ///< Lock of the bucket
+    std::atomic<size_t> size_;  ///< Number of entries, which lets the lookups skip the empty buckets without locking them
+    size_t next_;               ///< Entry to replace next when the bucket is full
+    std::vector<MemoEntry_t> entries_;
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-float WorkNode<PosStep, F, Ti, ArgT...>::simulate_ratio_successes;
-#endif
+    MemoBucket_t() :
+    busy_{false},
+    size_{0},
+    next_{0}
+    { }
 
-template <const bool PosStep, typename F, typename Ti, typename... ArgT>
-class ThreadPoolHandler {
-  using My_WorkNode_t = WorkNode<PosStep, F, Ti, ArgT...>;
+    void lock() noexcept
+    {
+      for (size_t polls = 0; busy_.exchange(true, std::memory_order_acquire); polls++) {
+        backoff(polls);
+      }
+    }
 
-  using TupleVal_t = typename ChunkVals_t<ArgT...>::TupleVal_t;
+    void unlock() noexcept { busy_.store(false, std::memory_order_release); }
+  };
 
-  const size_t min_paral_nthreads_;
+  const size_t memo_capacity_; ///< Maximum number of results of sequential runs remembered, 0 if they are not memoized
+  const size_t memo_ways_;     ///< Maximum number of results in a bucket of ::memo_
+  const size_t memo_buckets_;  ///< Number of buckets of ::memo_
+  std::unique_ptr<MemoBucket_t[]> memo_; ///< Results of sequential runs, hashed by the range of their chunk
+  std::atomic<size_t> memo_validations_; ///< Validations since the last failed one, saturated at ::memo_capacity_
+  std::atomic<size_t> nthreads_started_; ///< Number of threads of the pool that started working for this loop
   volatile bool finish_;
   My_WorkNode_t * volatile head_;
   const F& f_;
+  const Ti step_;
+  volatile Ti end_; ///< End of the loop. A nested loop is truncated when its parent is cancelled
+  ChunkSize_t chunk_size_; ///< Size of the chunks, in units of the loop index
+  FallbackMonitor_t fallback_; ///< Decides when to stop speculating because of the failures
+  const size_t fallback_probe_after_; ///< Iterations run sequentially after a fallback before speculating again (0 for the rest of the loop)
+  const size_t doall_after_; ///< Consecutive matching validations after which the chunks skip their sequential run, 0 if they never do
+  const size_t doall_probe_every_; ///< While the sequential runs are skipped, one in this number of chunks keeps it to check for dependences
+  std::atomic<size_t> doall_streak_; ///< Consecutive validations whose sequential results matched the speculated ones
+  std::atomic<bool> doall_active_; ///< Whether the chunks skip their sequential run
+  size_t doall_count_; ///< Speculative chunks created while the sequential runs are skipped, used to choose the probes. Only used by the calling thread
+  std::mutex doall_mutex_;
+  Ti doall_base_begin_; ///< Iteration where the loop rolls back if a probe finds a dependence
+  std::unique_ptr<TupleVal_t> doall_base_; ///< Values at ::doall_base_begin_, those of the last validation that compared them
+  std::atomic<bool> exited_; ///< Whether a validated chunk ended the loop, which is only possible in loops run by ::specWhile
+  CommonSpecInfo_t spec_infos_[2]; /**< There are at most 2 SpecInfos alive at a given point:
+                                    One associated to a failed speculation, and another one
+                                    associated to the subsequent chunks restarted from that point.
+                                  */
+  std::array<std::atomic<std::uintptr_t>, 2> spec_infos_sync_; /**< Synchronization array for the 2 SpecInfos that allows to ensure
+                                                                that they are no longer in use when they are going to be reset
+                                                              */
+  size_t curr_spec_info_idx_; ///< Currently active CommonSpecInfo_t in ThreadPoolHandler::spec_infos_
+  NodePool_t<My_WorkNode_t> own_pool_; ///< Pool of the chunks when the loop is not run in a Region
+  NodePool_t<My_WorkNode_t>& pool_;     ///< Pool the chunks are taken from
+  const bool keep_nodes_; ///< Whether the chunks of ::pool_ are kept constructed, as in the pools of a Region
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+  std::mutex stats_mutex_;
+  typename My_WorkNode_t::StatsRunInfoInternal stats_;
+#endif
+#ifdef SLSIMULATE
+  const bool simulate_mode_;
+  const float simulate_ratio_successes_;
+#endif
+  ThreadPool::Team team_; ///< Threads of ::SpecLibThreadPool working for this execution. Last member so that it is destroyed first
+
+  /// CPU for the thread with position \c i in the loop, -1 if it must not be pinned
+  int cpu(const size_t i) const noexcept { return cpus_.empty() ? -1 : cpus_[i % cpus_.size()]; }
+
+  /// Claims a portion of the chunk \c p for the calling thread, which is the one dedicated to the sequential runs
+  ///if \c seq_thread. That thread only claims sequential runs, and the rest leave them to it while it is polling for one
+  size_t claim(My_WorkNode_t& p, const bool seq_thread) noexcept
+  {
+    size_t n = p.in_threads_.load(std::memory_order_relaxed);
+    if (seq_thread) {
+      if (n || !p.in_threads_.compare_exchange_strong(n, 1)) {
+        return NoPortion;
+      }
+      seq_thread_waiting_.store(false, std::memory_order_relaxed);
+      return 0;
+    }
+    if (n >= p.paral_threads_) {
+      return NoPortion;
+    }
+    if (!n && seq_thread_waiting_.load()) {
+      return SeqLeft;
+    }
+    return p.in_threads_.fetch_add(1);
+  }
 
   void main()
   {
+    const size_t position = nthreads_started_.fetch_add(1, std::memory_order_relaxed) + 1;
+    // The first thread of the pool is pinned to the CPU of the sequential runs for the whole loop
+    const bool seq_thread = (seq_cpu_ >= 0) && (position == 1);
+    const AffinityGuard_t affinity(seq_thread ? seq_cpu_ : cpu((seq_cpu_ >= 0) ? (position - 1) : position));
+    if (seq_thread) {
+      seq_thread_waiting_.store(true);
+    }
 #if defined(SLSTATS) || defined(SLMINIMALSTATS)
     My_WorkNode_t::statsR.reset();
 #endif
@@ -895,10 +1461,15 @@ class ThreadPoolHandler {
     profile_clock_t::time_point t0 = profile_clock_t::now();
     profile_clock_t::time_point t1;
 #endif
+    size_t polls = 0;
     while (!finish_) {
+      const size_t push_count = push_count_.load();
       const auto curr_head = head_;
-      if ((curr_head != nullptr) && (curr_head->in_threads_.load(std::memory_order_relaxed) < curr_head->paral_threads_)) {
-        const size_t my_n = curr_head->in_threads_.fetch_add(1);
+      const size_t my_n = (curr_head != nullptr) ? claim(*curr_head, seq_thread) : NoPortion;
+      if (my_n == SeqLeft) {
+        relax(polls++); // the dedicated thread is about to take it, and then the parallel portions become available
+      } else if (my_n != NoPortion) {
+        polls = 0;
         if (!my_n) {
 #ifdef SLSTATS
           t1 = profile_clock_t::now();
@@ -907,6 +1478,9 @@ class ThreadPoolHandler {
 #else
           curr_head->seq_run(); // Runs the chunk sequentially
 #endif
+          if (seq_thread) {
+            seq_thread_waiting_.store(true);
+          }
 #ifdef SLSTATS
           t0 = profile_clock_t::now();
 #endif
@@ -929,26 +1503,33 @@ class ThreadPoolHandler {
           t0 = profile_clock_t::now();
 #endif
         }
+      } else {
+        idle(polls++, push_count, seq_thread);
       }
     }
+    if (seq_thread) {
+      seq_thread_waiting_.store(false);
+    }
 #ifdef SLSTATS
     t1 = profile_clock_t::now();
     const double lwtimeW3 = std::chrono::duration<double>(t1 - t0).count();
     {
-      std::lock_guard<std::mutex> lck(My_WorkNode_t::statsMutex);
-      My_WorkNode_t::statsRT.successes += My_WorkNode_t::statsR.successes;
-      My_WorkNode_t::statsRT.failures += My_WorkNode_t::statsR.failures;
-      My_WorkNode_t::statsRT.sequential += My_WorkNode_t::statsR.sequential;
-      My_WorkNode_t::statsRT.pt += My_WorkNode_t::statsR.pt;
-      My_WorkNode_t::statsRT.pt.gwtimeW3 += lwtimeW3;
+      std::lock_guard<std::mutex> lck(stats_mutex_);
+      stats_.successes += My_WorkNode_t::statsR.successes;
+      stats_.failures += My_WorkNode_t::statsR.failures;
+      stats_.sequential += My_WorkNode_t::statsR.sequential;
+      stats_.salvaged += My_WorkNode_t::statsR.salvaged;
+      stats_.pt += My_WorkNode_t::statsR.pt;
+      stats_.pt.gwtimeW3 += lwtimeW3;
     }
 #else
 #ifdef SLMINIMALSTATS
     {
-      std::lock_guard<std::mutex> lck(My_WorkNode_t::statsMutex);
-      My_WorkNode_t::statsRT.successes += My_WorkNode_t::statsR.successes;
-      My_WorkNode_t::statsRT.failures += My_WorkNode_t::statsR.failures;
-      My_WorkNode_t::statsRT.sequential += My_WorkNode_t::statsR.sequential;
+      std::lock_guard<std::mutex> lck(stats_mutex_);
+      stats_.successes += My_WorkNode_t::statsR.successes;
+      stats_.failures += My_WorkNode_t::statsR.failures;
+      stats_.sequential += My_WorkNode_t::statsR.sequential;
+      stats_.salvaged += My_WorkNode_t::statsR.salvaged;
     }
 #endif
 #endif
@@ -956,115 +1537,570 @@ class ThreadPoolHandler {
 
   const F& f() const noexcept { return f_; }
 
-  void push_chunk(WorkNode<PosStep, F, Ti, ArgT...> * const p) noexcept
+  /// Whether the chunk of the enclosing loop that runs this nested loop has been cancelled
+  bool parent_cancelled() const noexcept { return (parent_ != nullptr) && parent_->cancelled(); }
+
+  CommonSpecInfo_t& CurrentSpecInfo() noexcept { return spec_infos_[curr_spec_info_idx_]; }
+
+  /// Computes the length of the speculative chunk that starts at \c begin with the current chunk size
+  size_t spec_size(const Ti begin) const noexcept
+  {
+    const size_t chunk_size = chunk_size_.get();
+    const Ti end = end_;
+    return ((PosStep) ? static_cast<size_t>(std::min(end, begin + static_cast<Ti>(chunk_size)) - begin) : static_cast<size_t>(begin - std::max(end, begin - static_cast<Ti>(chunk_size))));
+  }
+
+  /// Chooses whether the next chunk, speculative if \c from_speculative, skips its sequential run (\c doall)
+  ///or keeps it as a probe while the others skip it (\c probe)
+  void doall_roles(const bool from_speculative, bool& doall, bool& probe) noexcept
+  {
+    const bool active = from_speculative && doall_active_.load(std::memory_order_relaxed);
+    doall = active && ((++doall_count_ % doall_probe_every_) != 0);
+    probe = active && !doall;
+  }
+
+  /// Notifies that the sequential results of the chunk that ends at \c end, \c vals, were validated,
+  ///matching the speculated ones unless they were \c repaired. After enough consecutive matches the chunks
+  ///begin to skip their sequential run, and from then on the matching values are where the loop rolls back
+  void doall_success(const Ti end, const TupleVal_t& vals, const bool repaired)
+  {
+    if (!doall_after_) {
+      return;
+    }
+    if (repaired) { // the chunks are not independent, even if they need no rerun
+      doall_streak_.store(0, std::memory_order_relaxed);
+    } else if (doall_active_.load(std::memory_order_relaxed) || ((doall_streak_.fetch_add(1, std::memory_order_relaxed) + 1) >= doall_after_)) {
+      std::lock_guard<std::mutex> lock(doall_mutex_);
+      doall_base_begin_ = end;
+      if (doall_base_) {
+        *doall_base_ = vals;
+      } else {
+        doall_base_.reset(new TupleVal_t(vals));
+      }
+      doall_active_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  /// Notifies a failed validation, which restarts the count of matches
+  void doall_failure() noexcept
+  {
+    doall_streak_.store(0, std::memory_order_relaxed);
+  }
+
+  /// Prepares the salvage of the snapshots of the chunk that begins at \c begin, which is going to be cancelled
+  /** Runs after the validations of the chunks whose sequential runs could still be using the previous ones */
+  void reset_salvage(const Ti begin)
+  {
+    if (checkpoint_interval_) {
+      std::lock_guard<std::mutex> lock(salvage_mutex_);
+      salvage_ready_.store(false, std::memory_order_relaxed);
+      salvage_.clear();
+      salvage_begin_.store(begin);
+    }
+  }
+
+  /// Bucket of ::memo_ of the chunks that run from \c begin to \c end
+  MemoBucket_t& memo_bucket(const Ti begin, const Ti end) const noexcept
+  {
+    std::size_t h = static_cast<std::size_t>(begin) * static_cast<std::size_t>(0x9E3779B97F4A7C15ull) ^ static_cast<std::size_t>(end);
+    h ^= h >> 29;
+    return memo_[h % memo_buckets_];
+  }
+
+  /// Whether a validation failed recently, so that the results of the sequential runs are worth remembering
+  bool memo_unstable() const noexcept
+  {
+    return memo_validations_.load(std::memory_order_relaxed) < memo_capacity_;
+  }
+
+  /// Notifies the outcome of a validation to decide whether the results of the sequential runs are remembered
+  void memo_outcome(const bool failed) noexcept
+  {
+    if (failed) {
+      memo_validations_.store(0, std::memory_order_relaxed);
+    } else if (memo_unstable()) {
+      memo_validations_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// Replaces \c vals, the state at \c begin, with the one at \c end if a previous run from that state is memoized
+  /** Only the entries of the same range are compared with the state */
+  bool memo_lookup(const Ti begin, const Ti end, TupleVal_t& vals)
+  {
+    MemoBucket_t& bucket = memo_bucket(begin, end);
+    if (!bucket.size_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::lock_guard<MemoBucket_t> lock(bucket);
+    const auto it = std::find_if(bucket.entries_.begin(), bucket.entries_.end(), [&](const MemoEntry_t& m) { return (m.begin_ == begin) && (m.end_ == end) && (m.start_ == vals); });
+    if (it == bucket.entries_.end()) {
+      return false;
+    }
+    vals = it->result_;
+    return true;
+  }
+
+  /// Remembers that the run from \c begin to \c end from the state \c start gave \c result. \c start is left unspecified
+  void memo_store(const Ti begin, const Ti end, TupleVal_t& start, const TupleVal_t& result)
+  {
+    MemoBucket_t& bucket = memo_bucket(begin, end);
+    std::lock_guard<MemoBucket_t> lock(bucket);
+    if (bucket.entries_.size() < memo_ways_) {
+      bucket.entries_.push_back(MemoEntry_t{begin, end, std::move(start), result});
+      bucket.size_.store(bucket.entries_.size(), std::memory_order_release);
+    } else {
+      MemoEntry_t& m = bucket.entries_[bucket.next_];
+      m.begin_ = begin;
+      m.end_ = end;
+      std::swap(m.start_, start);
+      m.result_ = result;
+      bucket.next_ = (bucket.next_ + 1) % memo_ways_;
+    }
+  }
+
+  /// Keeps the \c checkpoints of the cancelled chunk that begins at \c begin if they are the ones to salvage
+  void store_salvage(const Ti begin, std::vector<std::pair<Ti, TupleVal_t>>& checkpoints)
+  {
+    std::lock_guard<std::mutex> lock(salvage_mutex_);
+    if ((begin == salvage_begin_.load(std::memory_order_relaxed)) && !salvage_ready_.load(std::memory_order_relaxed)) {
+      salvage_.swap(checkpoints);
+      salvage_ready_.store(true, std::memory_order_release);
+    }
+  }
+
+  /// Restarts the execution from the last chunk whose sequential run was correct
+  void RecoverFromFailure()
+  {
+#ifdef SLSTATS
+    const profile_clock_t::time_point t0 = profile_clock_t::now();
+#endif
+    My_WorkNode_t * const curr_head = head_;
+    assert(curr_head != nullptr);
+    My_WorkNode_t * const last_correct_chunk = reinterpret_cast<My_WorkNode_t *>(CurrentSpecInfo().cancelled_node());
+    assert(curr_head != last_correct_chunk);
+#ifdef SLSTATS
+    const profile_clock_t::time_point t1 = profile_clock_t::now();
+#endif
+    curr_head->trigger_validation();
+#ifdef SLSTATS
+    const profile_clock_t::time_point t2 = profile_clock_t::now();
+#endif
+    for (size_t polls = 0; spec_infos_sync_[1u - curr_spec_info_idx_]; polls++) {
+      backoff(polls);
+    }
+    curr_spec_info_idx_ = 1u - curr_spec_info_idx_;
+    CurrentSpecInfo().reset(nthreads_ + 1);
+    My_WorkNode_t * const new_head = new_node();
+#ifdef SLSTATS
+    const profile_clock_t::time_point t3 = profile_clock_t::now();
+#endif
+    wait_spec_depth(); // the cancelled sequential runs may still be finishing
+    if (doall_active_.load(std::memory_order_relaxed)) {
+      // The chunks that skipped their sequential run since the last values compared may carry the dependence,
+      //so the loop rolls back to those values and all the chunks run their sequential run again
+      doall_active_.store(false, std::memory_order_relaxed);
+      std::lock_guard<std::mutex> lock(doall_mutex_);
+      new_head->restart(this, doall_base_begin_, *doall_base_);
+    } else if (fallback_.tripped()) {
+      // Speculation keeps failing, so the next iterations run sequentially, without overheads
+      const Ti begin = last_correct_chunk->end();
+      const Ti end = end_;
+      const size_t remaining = static_cast<size_t>((PosStep) ? (end - begin) : (begin - end));
+      const size_t probe = fallback_probe_after_ * static_cast<size_t>((PosStep) ? step_ : -step_);
+      fallback_.clear();
+      new_head->fill_sequential(last_correct_chunk, (probe && (probe < remaining)) ? probe : remaining);
+    } else {
+      new_head->fill(last_correct_chunk, false);
+    }
+    for (size_t polls = 0; last_correct_chunk->validation_state_.load(std::memory_order_relaxed) == 0; polls++) {
+      backoff(polls);
+    }
+    last_correct_chunk->free();
+#ifdef SLSTATS
+    const profile_clock_t::time_point t4 = profile_clock_t::now();
+    My_WorkNode_t::statsR.pt.gwtimeOF += std::chrono::duration<double>(t1 - t0).count() + std::chrono::duration<double>(t3 - t2).count() + std::chrono::duration<double>(t4 - new_head->wts5).count();
+#endif
+  }
+
+  /// Waits until the chunks with their sequential run in flight leave room for a new one
+  void wait_spec_depth() const noexcept
+  {
+    size_t polls = 0;
+    while (max_spec_depth_ && (seq_in_flight_.load(std::memory_order_relaxed) >= max_spec_depth_)) {
+      relax(polls++);
+    }
+  }
+
+  /// Waits after \c polls unsuccessful polls for another thread of the loop to finish a step of the execution.
+  /** Regardless of the idle policy, it yields the CPU after a few polls, as that thread may need it */
+  static void backoff(const size_t polls) noexcept
+  {
+    if (polls >= BackoffSpins) {
+      std::this_thread::yield();
+    }
+  }
+
+  /// Waits according to the idle policy after \c polls unsuccessful polls for work, never blocking
+  void relax(const size_t polls) const noexcept
+  {
+    if (polls >= idle_spins_) {
+      std::this_thread::yield();
+    }
+  }
+
+  /// Waits according to the idle policy after \c polls unsuccessful polls for work of a thread
+  ///that saw \c push_count chunks pushed. The thread may block until a new chunk is pushed.
+  ///While the thread dedicated to the sequential runs (\c seq_thread) is blocked, the rest take them
+  void idle(const size_t polls, const size_t push_count, const bool seq_thread)
+  {
+    if ((polls < idle_spins_) || ((polls - idle_spins_) < idle_yields_)) {
+      relax(polls);
+    } else {
+      if (seq_thread) {
+        seq_thread_waiting_.store(false);
+      }
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      parked_.fetch_add(1);
+      while ((push_count_.load() == push_count) && !finish_) {
+        idle_cond_var_.wait(lock);
+      }
+      parked_.fetch_sub(1, std::memory_order_relaxed);
+      if (seq_thread) {
+        seq_thread_waiting_.store(true);
+      }
+    }
+  }
+
+  /// Gets a chunk from the pool
+  My_WorkNode_t *new_node()
+  {
+    if (keep_nodes_) {
+      My_WorkNode_t * const p = pool_.malloc();
+      p->reset();
+      return p;
+    }
+    return pool_.defaultmalloc();
+  }
+
+  /// Returns a chunk to the pool
+  void free_node(My_WorkNode_t * const p) noexcept
+  {
+    if (keep_nodes_) {
+      pool_.shallow_free(p);
+    } else {
+      pool_.free(p);
+    }
+  }
+
+  /// Wakes up the threads blocked in ::idle
+  void wake_idle()
+  {
+    if (parked_.load()) {
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      idle_cond_var_.notify_all();
+    }
+  }
+
+  void push_chunk(WorkNode<PosStep, F, Ti, ArgT...> * const p)
   {
     head_ = p;
+    push_count_.fetch_add(1);
+    wake_idle();
   }
 
   friend class WorkNode<PosStep, F, Ti, ArgT...>;
 
 public:
 
+  /// \param pool Pool of kept constructed chunks to use, as those of a Region. nullptr to use a pool of its own
   template<typename... ArgT2>
-  ThreadPoolHandler(const size_t nthreads, const size_t min_paral_nthreads,
+  ThreadPoolHandler(const Configuration& config, NodePool_t<My_WorkNode_t> * const pool,
                     Ti begin, Ti end, Ti step,
                     size_t absolute_chunk_size, const F& f, ArgT2&&... args) :
-  min_paral_nthreads_{min_paral_nthreads},
+  parent_{CurrentExSpecInfo()},
+  nthreads_{0},
+  min_paral_nthreads_{config.min_paral_nthreads_},
+  dynamic_block_size_{config.dynamic_block_size_},
+  max_spec_depth_{config.max_spec_depth_},
+  seq_in_flight_{0},
+  idle_spins_{config.idle_spins_},
+  idle_yields_{config.idle_yields_},
+  push_count_{0},
+  parked_{0},
+  topology_placement_{(parent_ == nullptr) && ((config.affinity_ == Affinity::Compact) || (config.affinity_ == Affinity::Scatter))},
+  cpus_{topology_placement_.held() ? cpu_order(config.affinity_) : (((parent_ == nullptr) && (config.affinity_ == Affinity::List)) ? config.cpu_list_ : std::vector<int>())},
+  seq_cpu_{-1},
+  seq_thread_waiting_{false},
+  checkpoint_interval_{AllCheckpointable<ArgT...>::value ? config.checkpoint_interval_ : 0},
+  salvage_begin_{begin},
+  salvage_ready_{false},
+  memo_capacity_{AllCheckpointable<ArgT...>::value ? config.memo_capacity_ : 0},
+  memo_ways_{std::min(memo_capacity_, static_cast<size_t>(MemoWays))},
+  memo_buckets_{memo_capacity_ ? ((memo_capacity_ + memo_ways_ - 1) / memo_ways_) : 0},
+  memo_{memo_buckets_ ? new MemoBucket_t[memo_buckets_] : nullptr},
+  memo_validations_{memo_capacity_},
+  nthreads_started_{0},
   finish_{false},
   head_{nullptr},
-  f_{f}
+  f_{f},
+  step_{step},
+  end_{end},
+  fallback_probe_after_{config.fallback_probe_after_},
+  doall_after_{AllCheckpointable<ArgT...>::value ? config.doall_after_ : 0},
+  doall_probe_every_{std::max(config.doall_probe_every_, static_cast<size_t>(1))},
+  doall_streak_{0},
+  doall_active_{false},
+  doall_count_{0},
+  doall_base_begin_{begin},
+  exited_{false},
+  curr_spec_info_idx_{0},
+  own_pool_(4),
+  pool_{(pool != nullptr) ? *pool : own_pool_},
+  keep_nodes_{pool != nullptr}
+#ifdef SLSIMULATE
+  , simulate_mode_{config.simulate_ratio_successes_ >= 0.0f},
+  simulate_ratio_successes_{config.simulate_ratio_successes_}
+#endif
   {
 #ifdef SLSTATS
     const profile_clock_t::time_point t0 = profile_clock_t::now();
 #endif
 
-    SpecLibThreadPool().resize(nthreads);
-    SpecLibThreadPool().setFunction(&ThreadPoolHandler::main, this);
-    SpecLibThreadPool().launchTheads();
+    if (cpus_.size() > 2) {
+      // A thread of the pool is dedicated to the sequential runs on the second CPU, and the rest of the threads
+      //do not use its physical core. Another sequential run in flight at the same time is run by any other thread
+      seq_cpu_ = cpus_[1];
+      cpus_.erase(std::remove_if(cpus_.begin() + 1, cpus_.end(), [this](const int c) { return same_core(c, seq_cpu_); }), cpus_.end());
+    }
 
-    My_WorkNode_t::PrepareSpecInfo(this, step, end, absolute_chunk_size);
+    // Nested loops do not change the placement of the threads, and only borrow the idle threads of the pool, if any.
+    //Neither do the loops run while another one is placed according to the topology
+    const AffinityGuard_t affinity(cpu(0));
+    team_.setFunction(&ThreadPoolHandler::main, this);
+    nthreads_ = SpecLibThreadPool().launch(team_, config.nthreads_ - 1, parent_ != nullptr);
+
+    CurrentSpecInfo().reset(nthreads_ + 1);
+    spec_infos_sync_[0].store(static_cast<std::uintptr_t>(0u), std::memory_order_relaxed);
+    spec_infos_sync_[1].store(static_cast<std::uintptr_t>(0u), std::memory_order_relaxed);
+    chunk_size_.reset(absolute_chunk_size, static_cast<size_t>((PosStep) ? step : -step), config.min_chunk_size_, config.max_chunk_size_, config.grow_chunk_after_);
+    fallback_.reset(config.fallback_failure_ratio_, config.fallback_window_);
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+    My_WorkNode_t::statsR.reset();
+#endif
 
 #ifdef SLSTATS
     const profile_clock_t::time_point t1 = profile_clock_t::now();
     const double lwtimeOPi = std::chrono::duration<double>(t1 - t0).count();
 #endif
 
-    My_WorkNode_t::Pool.defaultmalloc()->fill(begin, std::forward<ArgT2>(args)...);
+    if (nthreads_) {
+      new_node()->fill(this, begin, std::forward<ArgT2>(args)...);
+    } else {
+      // A nested loop that finds no idle threads runs inline in the calling thread instead of adding threads to the pool
+      new_node()->fill_sequential(this, begin, static_cast<size_t>((PosStep) ? (end - begin) : (begin - end)), std::forward<ArgT2>(args)...);
+    }
 
+    size_t depth_polls = 0;
     do {
-      while((PosStep) ? (head_->end() < end) : (head_->end() > end)) {
-        if (My_WorkNode_t::CurrentSpecInfo().failed()) {
-          My_WorkNode_t::RecoverFromFailure(head_);
-        } else {
-          My_WorkNode_t::Pool.defaultmalloc()->fill(head_, true);
+      while((PosStep) ? (head_->end() < end_) : (head_->end() > end_)) {
+        if (parent_cancelled()) {
+          // The result will be discarded, so the loop is truncated at the last chunk created,
+          //whose bodies, as those of the chunks in flight, finish quickly seeing themselves cancelled
+          end_ = head_->end();
+        } else if (CurrentSpecInfo().failed()) {
+          RecoverFromFailure();
+        } else if (exited_.load(std::memory_order_acquire)) {
+          // The chunks created after the one that ended the loop do not run any iteration,
+          //so the loop is truncated at the last one created
+          end_ = head_->end();
+        } else if (!max_spec_depth_ || (seq_in_flight_.load(std::memory_order_relaxed) < max_spec_depth_)) {
+          depth_polls = 0;
+          new_node()->fill(head_, true);
+        } else { // wait for the sequential runs of older chunks to finish before speculating deeper
+          relax(depth_polls++);
         }
       }
     } while (!head_->wait_success());
 #ifdef SLSTATS
     {
-      std::lock_guard<std::mutex> lck(My_WorkNode_t::statsMutex);
-      My_WorkNode_t::statsRT.successes += My_WorkNode_t::statsR.successes;
-      My_WorkNode_t::statsRT.failures += My_WorkNode_t::statsR.failures;
-      My_WorkNode_t::statsRT.sequential += My_WorkNode_t::statsR.sequential;
-      My_WorkNode_t::statsRT.pt += My_WorkNode_t::statsR.pt;
-      My_WorkNode_t::statsRT.pt.gwtimeOPi += lwtimeOPi;
+      std::lock_guard<std::mutex> lck(stats_mutex_);
+      stats_.successes += My_WorkNode_t::statsR.successes;
+      stats_.failures += My_WorkNode_t::statsR.failures;
+      stats_.sequential += My_WorkNode_t::statsR.sequential;
+      stats_.salvaged += My_WorkNode_t::statsR.salvaged;
+      stats_.pt += My_WorkNode_t::statsR.pt;
+      stats_.pt.gwtimeOPi += lwtimeOPi;
     }
 #else
 #ifdef SLMINIMALSTATS
     {
-      std::lock_guard<std::mutex> lck(My_WorkNode_t::statsMutex);
-      My_WorkNode_t::statsRT.successes += My_WorkNode_t::statsR.successes;
-      My_WorkNode_t::statsRT.failures += My_WorkNode_t::statsR.failures;
-      My_WorkNode_t::statsRT.sequential += My_WorkNode_t::statsR.sequential;
+      std::lock_guard<std::mutex> lck(stats_mutex_);
+      stats_.successes += My_WorkNode_t::statsR.successes;
+      stats_.failures += My_WorkNode_t::statsR.failures;
+      stats_.sequential += My_WorkNode_t::statsR.sequential;
+      stats_.salvaged += My_WorkNode_t::statsR.salvaged;
     }
 #endif
 #endif
   }
 
-  size_t nthreads() const noexcept { return SpecLibThreadPool().nthreads(); }
+  size_t nthreads() const noexcept { return nthreads_; }
 
   size_t min_paral_nthreads() const noexcept { return min_paral_nthreads_; }
 
   const TupleVal_t& result() const noexcept
   {
-    assert(!(My_WorkNode_t::CurrentSpecInfo()).failed());
+    assert(!(spec_infos_[curr_spec_info_idx_]).failed());
     assert(head_ != nullptr);
     return head_->result();
   }
 
+  /// Releases the last chunk and waits for the threads of the pool to leave this execution
+  void join() noexcept
+  {
+    if (!finish_) {
+      assert(head_ != nullptr);
+      head_->free();
+      finish_ = true;
+      push_count_.fetch_add(1);
+      wake_idle();
+      team_.wait();
+    }
+  }
+
+#ifdef SLSTATS
+  /// Statistics of the execution. Only complete after ::join
+  StatsRunInfo stats(const double total_time) const
+  {
+    return StatsRunInfo(nthreads_ + 1, stats_.successes, stats_.failures, stats_.sequential, total_time, stats_.pt, stats_.salvaged);
+  }
+#else
+#ifdef SLMINIMALSTATS
+  /// Statistics of the execution. Only complete after ::join
+  StatsRunInfo stats() const
+  {
+    return StatsRunInfo(nthreads_ + 1, stats_.successes, stats_.failures, stats_.sequential, 0.0, stats_.salvaged);
+  }
+#endif
+#endif
+
   ~ThreadPoolHandler()
   {
-    assert(head_ != nullptr);
-    head_->free();
-    finish_ = true;
-    SpecLibThreadPool().wait();
+    join();
   }
 
 };
 
 } //namespace internal
-                      
-/// \brief Runs the speculative loop
-/// \tparam    F         Type of the function that provides the body of the loop
-/// \tparam    Args      Types of the objects on which the speculation is performed
-/// \param[in] config    Configuration of the parallel execution
-/// \param[in] begin     Starting point for the loop
-/// \param[in] end       Limit of the loop in C style
-/// \param[in] step      Step of the loop
-/// \param[in] specChunk Number of iterations in each speculative chunk
-/// \param[in] f         Function that implements the body of the loop
-/// \param[in,out] args  Objects on which the speculation is performed
-template <typename F, typename Ti, typename... ArgT>
+
 #if !defined(SLSTATS) && !defined(SLMINIMALSTATS)
-void specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+using SpecRunResult_t = void; ///< Type returned by ::specRun
 #else
-StatsRunInfo specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+using SpecRunResult_t = StatsRunInfo; ///< Type returned by ::specRun
 #endif
+
+/// \brief Resources kept across the executions of the speculative loops run through it
+///
+/// Loops run many times, for example in every step of a simulation, can be run through the same
+/// Region to save most of the setup of each execution. The region keeps in the pool the threads
+/// its loops need, and for every type of loop (body and types of the arguments) the chunks of the
+/// previous executions, whose copies of the arguments keep their buffers for the next ones.
+/// A region runs one loop at a time, and it must outlive the loops run through it
+class Region {
+
+  /// Resources kept for a type of loop
+  struct Slot_t {
+    const void * const key_;
+    std::unique_ptr<Slot_t> next_;
+
+    Slot_t(const void * const key, std::unique_ptr<Slot_t>&& next) :
+    key_{key},
+    next_{std::move(next)}
+    { }
+
+    virtual ~Slot_t() {}
+  };
+
+  template<typename Node>
+  struct PoolSlot_t : Slot_t {
+    internal::NodePool_t<Node> pool_;
+
+    PoolSlot_t(const void * const key, std::unique_ptr<Slot_t>&& next) :
+    Slot_t(key, std::move(next)),
+    pool_(4, static_cast<int>(sizeof(Node)), true)
+    { }
+  };
+
+  /// Identifies the type \c T by the address of its member
+  template<typename T>
+  struct TypeKey_t {
+    static const char id;
+  };
+
+  std::unique_ptr<Slot_t> slots_;
+  size_t nthreads_;
+
+public:
+
+  /// Region whose loops use up to \c nthreads threads, which are created in advance
+  explicit Region(const size_t nthreads = 0) :
+  nthreads_{nthreads}
+  {
+    internal::SpecLibThreadPool().reserve((nthreads > 1) ? (nthreads - 1) : 0);
+  }
+
+  Region(const Region&) = delete;
+  Region& operator=(const Region&) = delete;
+
+  /// Number of threads reserved for the loops of the region
+  size_t nthreads() const noexcept { return nthreads_; }
+
+  /// Releases the resources kept for the loops run so far
+  void clear() noexcept
+  {
+    // Destroys the list iteratively, so that a region used for many types of loops cannot exhaust the stack
+    while (slots_) {
+      std::unique_ptr<Slot_t> next = std::move(slots_->next_);
+      slots_ = std::move(next);
+    }
+  }
+
+  /// \internal Pool of the chunks of type \c Node, kept constructed between executions
+  template<typename Node>
+  internal::NodePool_t<Node>& node_pool()
+  {
+    const void * const key = &TypeKey_t<Node>::id;
+    for (Slot_t *p = slots_.get(); p != nullptr; p = p->next_.get()) {
+      if (p->key_ == key) {
+        return static_cast<PoolSlot_t<Node> *>(p)->pool_;
+      }
+    }
+    slots_.reset(new PoolSlot_t<Node>(key, std::move(slots_)));
+    return static_cast<PoolSlot_t<Node> *>(slots_.get())->pool_;
+  }
+
+  /// \brief Runs the speculative loop with the resources of the region
+  ///
+  /// The parameters have the same meaning as in ::specRun
+  template <typename F, typename Ti, typename... ArgT>
+  SpecRunResult_t specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args);
+
+  ~Region()
+  {
+    clear();
+  }
+
+};
+
+template<typename T>
+const char Region::TypeKey_t<T>::id = 0;
+
+namespace internal {
+
+/// Runs the loop of ::specRun taking its chunks from \c region, or from a pool of its own if it is nullptr
+template <typename F, typename Ti, typename... ArgT>
+SpecRunResult_t run_spec_loop(Region * const region, Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
 {
-#if defined(SLSTATS) || defined(SLMINIMALSTATS) || defined(SLSIMULATE)
-  using My_Work_Node_Pos_t = internal::WorkNode<true, F, Ti, typename internal::SpecType<ArgT>::type...>;
-  using My_Work_Node_Neg_t = internal::WorkNode<false, F, Ti, typename internal::SpecType<ArgT>::type...>;
-#endif
   static_assert(std::is_integral<Ti>::value, "Integer required.");
 #ifdef SLSTATS
   const profile_clock_t::time_point start_time = profile_clock_t::now();
@@ -1075,28 +2111,19 @@ StatsRunInfo specRun(Configuration config, const typename std::remove_reference<
       config.nthreads_ = std::max(config.nthreads_, static_cast<size_t>(3));
       config.min_paral_nthreads_ = std::max(std::min(config.min_paral_nthreads_, config.nthreads_), static_cast<size_t>(2));
       specChunk = std::max(specChunk, static_cast<size_t>(1));
-#ifdef SLSIMULATE
-      if (config.simulate_ratio_successes_ < 0.0f) {
-        config.simulate_ratio_successes_ = -1.0f;
-        My_Work_Node_Pos_t::simulate_mode = false;
-      } else {
-        My_Work_Node_Pos_t::simulate_mode = true;
-      }
-      My_Work_Node_Pos_t::simulate_ratio_successes = config.simulate_ratio_successes_;
-#endif
-      {
-        internal::ThreadPoolHandler<true, F, Ti, typename internal::SpecType<ArgT>::type...> thread_pool(config.nthreads_ - 1, config.min_paral_nthreads_, begin, end, step, specChunk * (size_t)(step), f, std::forward<ArgT>(args)...);
-        std::tie(internal::final_spec_assign(args)...) = thread_pool.result();
-      }
+      ThreadPoolHandler<true, F, Ti, typename SpecType<ArgT>::type...> thread_pool(config, (region != nullptr) ? &region->node_pool<WorkNode<true, F, Ti, typename SpecType<ArgT>::type...>>() : nullptr, begin, end, step, specChunk * (size_t)(step), f, std::forward<ArgT>(args)...);
+      std::tie(final_spec_assign(args)...) = thread_pool.result();
 #ifdef SLSTATS
+      thread_pool.join();
       const profile_clock_t::time_point end_time = profile_clock_t::now();
       const double total_time = std::chrono::duration<double>(end_time - start_time).count();
-      return StatsRunInfo(config.nthreads_, My_Work_Node_Pos_t::statsRT.successes, My_Work_Node_Pos_t::statsRT.failures, My_Work_Node_Pos_t::statsRT.sequential, total_time, My_Work_Node_Pos_t::statsRT.pt);
+      return thread_pool.stats(total_time);
     }
     return StatsRunInfo(0, 0, 0, 0);
 #else
 #ifdef SLMINIMALSTATS
-      return StatsRunInfo(config.nthreads_, My_Work_Node_Pos_t::statsRT.successes, My_Work_Node_Pos_t::statsRT.failures, My_Work_Node_Pos_t::statsRT.sequential);
+      thread_pool.join();
+      return thread_pool.stats();
     }
     return StatsRunInfo(0, 0, 0, 0);
 #else
@@ -1108,28 +2135,19 @@ StatsRunInfo specRun(Configuration config, const typename std::remove_reference<
       config.nthreads_ = std::max(config.nthreads_, static_cast<size_t>(3));
       config.min_paral_nthreads_ = std::max(std::min(config.min_paral_nthreads_, config.nthreads_), static_cast<size_t>(2));
       specChunk = std::max(specChunk, static_cast<size_t>(1));
-#ifdef SLSIMULATE
-      if (config.simulate_ratio_successes_ < 0.0f) {
-        config.simulate_ratio_successes_ = -1.0f;
-        My_Work_Node_Neg_t::simulate_mode = false;
-      } else {
-        My_Work_Node_Neg_t::simulate_mode = true;
-      }
-      My_Work_Node_Neg_t::simulate_ratio_successes = config.simulate_ratio_successes_;
-#endif
-      {
-        internal::ThreadPoolHandler<false, F, Ti, typename internal::SpecType<ArgT>::type...> thread_pool(config.nthreads_ - 1, config.min_paral_nthreads_, begin, end, step, specChunk * (size_t)(-step), f, std::forward<ArgT>(args)...);
-        std::tie(internal::final_spec_assign(args)...) = thread_pool.result();
-      }
+      ThreadPoolHandler<false, F, Ti, typename SpecType<ArgT>::type...> thread_pool(config, (region != nullptr) ? &region->node_pool<WorkNode<false, F, Ti, typename SpecType<ArgT>::type...>>() : nullptr, begin, end, step, specChunk * (size_t)(-step), f, std::forward<ArgT>(args)...);
+      std::tie(final_spec_assign(args)...) = thread_pool.result();
 #ifdef SLSTATS
+      thread_pool.join();
       const profile_clock_t::time_point end_time = profile_clock_t::now();
       const double total_time = std::chrono::duration<double>(end_time - start_time).count();
-      return StatsRunInfo(config.nthreads_, My_Work_Node_Neg_t::statsRT.successes, My_Work_Node_Neg_t::statsRT.failures, My_Work_Node_Neg_t::statsRT.sequential, total_time, My_Work_Node_Neg_t::statsRT.pt);
+      return thread_pool.stats(total_time);
     }
     return StatsRunInfo(0, 0, 0, 0);
 #else
 #ifdef SLMINIMALSTATS
-      return StatsRunInfo(config.nthreads_, My_Work_Node_Neg_t::statsRT.successes, My_Work_Node_Neg_t::statsRT.failures, My_Work_Node_Neg_t::statsRT.sequential);
+      thread_pool.join();
+      return thread_pool.stats();
     }
     return StatsRunInfo(0, 0, 0, 0);
 #else
@@ -1139,6 +2157,220 @@ StatsRunInfo specRun(Configuration config, const typename std::remove_reference<
   }
 }
 
+} //namespace internal
+/// \brief Runs the speculative loop
+/// \tparam    F         Type of the function that provides the body of the loop
+/// \tparam    Args      Types of the objects on which the speculation is performed
+/// \param[in] config    Configuration of the parallel execution
+/// \param[in] begin     Starting point for the loop
+/// \param[in] end       Limit of the loop in C style
+/// \param[in] step      Step of the loop
+/// \param[in] specChunk Number of iterations in each speculative chunk (initial number if the
+///                      configuration enables an adaptive chunk size)
+/// \param[in] f         Function that implements the body of the loop
+/// \param[in,out] args  Objects on which the speculation is performed
+template <typename F, typename Ti, typename... ArgT>
+#if !defined(SLSTATS) && !defined(SLMINIMALSTATS)
+void specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+#else
+StatsRunInfo specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+#endif
+{
+  return internal::run_spec_loop<F, Ti, ArgT...>(nullptr, config, begin, end, step, specChunk, f, std::forward<ArgT>(args)...);
+}
+
+template <typename F, typename Ti, typename... ArgT>
+SpecRunResult_t Region::specRun(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+{
+  return internal::run_spec_loop<F, Ti, ArgT...>(this, config, begin, end, step, specChunk, f, std::forward<ArgT>(args)...);
+}
+
+/// \brief Creates in advance the threads needed by loops of \c nthreads threads
+/// \internal Otherwise they are created on demand by the first loop that needs them
+inline void init(const size_t nthreads)
+{
+  internal::SpecLibThreadPool().reserve((nthreads > 1) ? (nthreads - 1) : 0);
+}
+
+/// \brief Changes the number of threads kept by the runtime to those needed by loops of \c nthreads threads
+/// \internal Surplus threads are terminated if they are idle. Loops that need more threads create them on demand
+inline void reinit(const size_t nthreads)
+{
+  internal::SpecLibThreadPool().resize((nthreads > 1) ? (nthreads - 1) : 0);
+}
+
+/// \brief Terminates the idle threads of the runtime
+/// \internal They are created again on demand if later loops need them
+inline void shutdown()
+{
+  internal::SpecLibThreadPool().resize(0);
+}
+
+/// \brief Runs the speculative loop on the positions of a range given by random-access iterators
+///
+/// The chunks are computed on the distance from \c first, so the body gets the iterators
+/// of the range directly rather than indices to translate. The body \c f is either
+/// <tt>f(It i, args...)</tt> or <tt>f(const ExCommonSpecInfo_t& cs, It begin, It end, difference_type step, args...)</tt>,
+/// and the rest of the parameters have the same meaning as in the integer version of ::specRun
+template <typename F, typename It, typename... ArgT>
+std::enable_if_t<internal::IsRandomAccessIterator<It>::value, SpecRunResult_t> specRun(Configuration config, const It first, const It last, size_t specChunk, const F& f, ArgT&&... args)
+{
+  using Distance_t = typename std::iterator_traits<It>::difference_type;
+  const internal::IterBodyFor_t<It, F> body(first, f);
+  return specRun(config, static_cast<Distance_t>(0), static_cast<Distance_t>(last - first), static_cast<Distance_t>(1), specChunk, body, std::forward<ArgT>(args)...);
+}
+
+/// \brief Runs the speculative loop on the elements of a container or view with random-access iterators
+///
+/// This includes, among others, \c std::vector, \c std::array and, in C++20, \c std::span.
+/// The body gets iterators to the elements as in the version of ::specRun for iterator ranges
+template <typename F, typename R, typename... ArgT>
+std::enable_if_t<internal::IsRandomAccessIterator<typename internal::RangeIterator_t<R>::type>::value, SpecRunResult_t> specRun(Configuration config, R&& range, size_t specChunk, const F& f, ArgT&&... args)
+{
+  return specRun(config, std::begin(range), std::end(range), specChunk, f, std::forward<ArgT>(args)...);
+}
+
+/// \brief Runs speculatively a loop whose number of iterations is not known in advance
+///
+/// The body <tt>bool f(Ti i, args...)</tt> returns false in the last iteration of the loop, whose
+/// effects are kept, like in a <tt>do { } while (cond)</tt> loop or one that ends with a \c break.
+/// The chunks run speculatively past the end of the loop do not modify the arguments, and no new
+/// chunks are created once a validated chunk ends the loop. The loop ends anyway after reaching
+/// halfway between \c begin and the limit of \c Ti in the direction of \c step, so that the
+/// computation of the chunks cannot overflow. The rest of the parameters have the same meaning
+/// as in ::specRun
+template <typename F, typename Ti, typename... ArgT>
+SpecRunResult_t specWhile(Configuration config, const Ti begin, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+{
+  static_assert(std::is_integral<Ti>::value, "Integer required.");
+  const bool posStep = (std::is_unsigned<Ti>::value || (step >= 0));
+  const Ti end = posStep ? static_cast<Ti>(begin + (std::numeric_limits<Ti>::max() / 2 - begin / 2)) : static_cast<Ti>(begin - (begin / 2 - std::numeric_limits<Ti>::min() / 2));
+  internal::LoopExit_t<Ti> loop_exit;
+  const internal::WhileBody_t<Ti, F> body(f);
+  return specRun(config, begin, end, step, specChunk, body, loop_exit, std::forward<ArgT>(args)...);
+}
+
+namespace internal {
+
+/// \brief Loop launched by ::specRunAsync, which runs in a thread of the pool of the runtime
+/// \internal The thread that drives the loop is taken from the pool like the ones of its team,
+///           so it counts against the limit of the pool rather than being an extra thread
+class AsyncRun_t {
+
+  std::packaged_task<SpecRunResult_t()> task_;
+  ThreadPool::Team team_; // destroyed first, thus waiting for the thread that runs task_
+
+public:
+
+  template <typename G>
+  AsyncRun_t(G&& g) :
+  task_{std::forward<G>(g)}
+  {}
+
+  AsyncRun_t(const AsyncRun_t&) = delete;
+  AsyncRun_t& operator=(const AsyncRun_t&) = delete;
+
+  /// Launches the loop in a thread of the pool
+  std::future<SpecRunResult_t> launch()
+  {
+    std::future<SpecRunResult_t> future = task_.get_future();
+    team_.setFunction([this] { task_(); });
+    SpecLibThreadPool().launch(team_, 1);
+    return future;
+  }
+
+};
+
+} //namespace internal
+
+/// \brief Handle to a speculative loop launched by ::specRunAsync
+/// \internal The destructor waits for the loop to finish, so that the objects on which the
+///           speculation is performed are never used after the handle is gone
+class SpecRunHandle {
+
+  std::unique_ptr<internal::AsyncRun_t> run_;
+  std::future<SpecRunResult_t> future_;
+  bool done_;
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+  StatsRunInfo stats_;
+#endif
+
+public:
+
+  SpecRunHandle(std::unique_ptr<internal::AsyncRun_t>&& run) :
+  run_{std::move(run)},
+  future_{run_->launch()},
+  done_{false}
+  {}
+
+  SpecRunHandle(SpecRunHandle&& other) = default;
+
+  SpecRunHandle& operator=(SpecRunHandle&& other) = default;
+
+  /// Wait for the loop to finish. Rethrows the exceptions raised during its execution
+  void wait()
+  {
+    if (!done_) {
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+      stats_ = future_.get();
+#else
+      future_.get();
+#endif
+      done_ = true;
+    }
+  }
+
+  /// Whether the loop finished, and thus ::wait will not block
+  bool ready() const
+  {
+    return done_ || (future_.valid() && (future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready));
+  }
+
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+  /// Statistics of the execution. Waits for the loop to finish
+  const StatsRunInfo& stats()
+  {
+    wait();
+    return stats_;
+  }
+#endif
+
+  ~SpecRunHandle()
+  {
+    if (!done_ && future_.valid()) {
+      future_.wait();
+    }
+  }
+
+};
+
+namespace internal {
+
+template <typename F, typename Ti, typename Tuple, std::size_t... Is>
+SpecRunResult_t specRun_tuple_helper(const Configuration& config, const Ti begin, const Ti end, const Ti step, const size_t specChunk, const F& f, Tuple& args, std::index_sequence<Is...>)
+{
+  return specRun(config, begin, end, step, specChunk, f, std::get<Is>(args)...);
+}
+
+} //namespace internal
+
+/// \brief Runs the speculative loop in the background and returns a handle to it
+///
+/// The parameters have the same meaning as in ::specRun. The arguments provided as lvalues
+/// are used by reference, so they must not be accessed until the returned handle is waited
+/// for or destroyed, while rvalue arguments are moved into the handle. The function \c f is copied.
+/// The loop is driven by a thread of the pool of the runtime rather than by the calling thread,
+/// and this thread is one of the \c config.nthreads_ threads of the loop
+template <typename F, typename Ti, typename... ArgT>
+SpecRunHandle specRunAsync(Configuration config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, size_t specChunk, const F& f, ArgT&&... args)
+{
+  using Tuple_t = std::tuple<ArgT...>;
+  return SpecRunHandle(std::make_unique<internal::AsyncRun_t>(
+                                  [config, begin, end, step, specChunk, f, targs = Tuple_t(std::forward<ArgT>(args)...)]() mutable {
+                                    return internal::specRun_tuple_helper<F, std::remove_cv_t<std::remove_reference_t<Ti>>>(config, begin, end, step, specChunk, f, targs, std::index_sequence_for<ArgT...>{});
+                                  }));
+}
+
 } //namespace SpecLib
 
 #endif
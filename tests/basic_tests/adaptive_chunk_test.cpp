@@ -0,0 +1,177 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     adaptive_chunk_test.cpp
+/// \brief    Test on the adaptive size of the chunks with a loop whose dependences change across its execution
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <thread>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The first quarter of the loop carries a true dependence in some iterations, while the rest only computes a maximum
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if ((iteration < N / 4) && !(iteration % 64)) {
+    result = (result / 2) + (Vals[iteration] / 4);
+  } else if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+std::atomic<size_t> MaxSeqChunk; ///< Longest sequential run of a chunk observed in the last test
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration adaptive_config()
+{
+  SpecLib::Configuration config = default_config();
+  const size_t chunk_size = SpecLib::getChunkSize(N, NChunks);
+  config.min_chunk_size_ = std::max(chunk_size / 16, static_cast<size_t>(1));
+  config.max_chunk_size_ = chunk_size * 4;
+  return config;
+}
+
+bool lambda_test()
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(adaptive_config(), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test()
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    if (!cs.isParExec) { // the sequential runs span whole chunks
+      // Delayed so that they finish after the parallel runs, whose validations are the ones that resize the chunks
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      size_t max_chunk = MaxSeqChunk.load();
+      while ((max_chunk < (end - begin)) && !MaxSeqChunk.compare_exchange_weak(max_chunk, end - begin));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  MaxSeqChunk.store(0);
+  // The successes in the last three quarters of the loop must have grown the chunks
+  const bool test_ok = bench(adaptive_config(), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec) && (MaxSeqChunk.load() > SpecLib::getChunkSize(N, NChunks));
+
+  std::cout << "Lambda loop: " << result_spec << " " << MaxSeqChunk.load() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Checks that the size grows only after the required consecutive successes and shrinks after every failure, within its bounds
+bool chunk_size_test()
+{ SpecLib::internal::ChunkSize_t chunk_size;
+
+  chunk_size.reset(100, 2, 10, 400, 2);
+  bool test_ok = chunk_size.adaptive() && (chunk_size.get() == 100);
+  chunk_size.success();
+  test_ok = test_ok && (chunk_size.get() == 100);
+  chunk_size.success();
+  test_ok = test_ok && (chunk_size.get() == 200);
+  chunk_size.success();
+  chunk_size.failure(); // resets the consecutive successes
+  test_ok = test_ok && (chunk_size.get() == 100);
+  chunk_size.success();
+  test_ok = test_ok && (chunk_size.get() == 100);
+  for (int i = 0; i < 16; i++) {
+    chunk_size.success();
+  }
+  test_ok = test_ok && (chunk_size.get() == 800); // 400 iterations of step 2
+  for (int i = 0; i < 16; i++) {
+    chunk_size.failure();
+  }
+  test_ok = test_ok && (chunk_size.get() == 20); // 10 iterations of step 2
+
+  chunk_size.reset(100, 1, 10, 0, 2);
+  chunk_size.success();
+  chunk_size.success();
+  chunk_size.failure();
+  test_ok = test_ok && !chunk_size.adaptive() && (chunk_size.get() == 100);
+
+  std::cout << "Chunk size: " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool fixed_test()
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Fixed : " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return chunk_size_test() && lambda_test() && lambda_loop_test() && fixed_test() ? 0 : -1;
+}
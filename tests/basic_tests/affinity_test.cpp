@@ -0,0 +1,253 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     affinity_test.cpp
+/// \brief    Test on the placement policies of the threads
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <set>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The first quarter of the loop carries a true dependence in some iterations, while the rest only computes a maximum
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if ((iteration < N / 4) && !(iteration % 64)) {
+    result = (result / 2) + (Vals[iteration] / 4);
+  } else if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration affinity_config(const SpecLib::Affinity affinity)
+{
+  SpecLib::Configuration config = default_config();
+  config.affinity_ = affinity;
+  if (affinity == SpecLib::Affinity::List) {
+    for (size_t i = 0; i < NThreads; i++) {
+      config.cpu_list_.push_back(static_cast<int>(i % std::max(std::thread::hardware_concurrency(), 1u)));
+    }
+  }
+  return config;
+}
+
+bool affinity_test(const char * const name, const SpecLib::Affinity affinity)
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(affinity_config(affinity), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << name << ": " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+#ifdef __linux__
+
+/// CPUs the threads that ran the chunks of a loop were allowed to use
+struct Placement_t {
+  std::mutex mutex_;
+  std::map<std::thread::id, cpu_set_t> masks_; ///< Last mask of each thread in the parallel runs
+  std::vector<cpu_set_t> seq_masks_;           ///< Masks of the threads in the sequential runs
+
+  void record(const bool par)
+  { cpu_set_t mask;
+
+    if (!sched_getaffinity(0, sizeof(mask), &mask)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (par) {
+        masks_[std::this_thread::get_id()] = mask;
+      } else {
+        seq_masks_.push_back(mask);
+      }
+    }
+  }
+
+  /// Inserts in \c cpus the CPU of \c mask. Returns false if it is not a single CPU
+  static bool pinned_cpu(const cpu_set_t& mask, std::multiset<int>& cpus)
+  {
+    if (CPU_COUNT(&mask) != 1) {
+      return false;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.insert(cpu);
+      }
+    }
+    return true;
+  }
+
+  /// CPUs the threads were pinned to in the parallel runs, if they were all pinned to a single CPU
+  bool pinned_cpus(std::multiset<int>& cpus) const
+  {
+    for (const auto& thread_mask : masks_) {
+      if (!pinned_cpu(thread_mask.second, cpus)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// CPUs the threads were pinned to in the sequential runs, if they were all pinned to a single CPU
+  bool pinned_seq_cpus(std::multiset<int>& cpus) const
+  {
+    for (const auto& mask : seq_masks_) {
+      if (!pinned_cpu(mask, cpus)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/// CPUs the process can run on. Placements can only be told apart from an unpinned execution if there are several
+int process_cpus()
+{ cpu_set_t mask;
+
+  return sched_getaffinity(0, sizeof(mask), &mask) ? 0 : CPU_COUNT(&mask);
+}
+
+/// Runs a loop recording where its threads run. The threads wait until \c all_started loops started running chunks
+bool placed_loop(const SpecLib::Affinity affinity, Placement_t& placement, std::atomic<int>& started, const int all_started)
+{ int loop_result = 0;
+
+  std::atomic<bool> first{true};
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    placement.record(cs.isParExec);
+    if (first.exchange(false)) {
+      started++;
+    }
+    while (started.load() < all_started) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  SpecLib::specRun(affinity_config(affinity), 0, N, 1, SpecLib::getChunkSize(N, NChunks), loop_f, loop_result);
+  return loop_result == ResultSeq;
+}
+
+/// Checks with sched_getaffinity that the threads of a loop are pinned to different CPUs, when there are enough,
+///and that some sequential runs took a CPU that no parallel run used
+bool placement_test(const char * const name, const SpecLib::Affinity affinity)
+{ Placement_t placement;
+  std::atomic<int> started{0};
+  std::multiset<int> cpus, seq_cpus;
+
+  const bool result_ok = placed_loop(affinity, placement, started, 1);
+  const bool pinned = placement.pinned_cpus(cpus) && placement.pinned_seq_cpus(seq_cpus);
+  // the physical core of the CPU of the sequential runs is not available to the rest of the threads
+  const bool distinct = (cpus.size() + 2 > static_cast<size_t>(process_cpus())) || (std::set<int>(cpus.begin(), cpus.end()).size() == cpus.size());
+  const bool dedicated = (process_cpus() < 3) || std::any_of(seq_cpus.begin(), seq_cpus.end(), [&cpus](const int cpu) { return !cpus.count(cpu); });
+  const bool test_ok = result_ok && pinned && distinct && dedicated;
+
+  std::cout << name << " placement: " << placement.masks_.size() << " threads pinned " << (pinned ? 'Y' : 'N') << " distinct " << (distinct ? 'Y' : 'N') << " dedicated sequential CPU " << (dedicated ? 'Y' : 'N') << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Checks that two concurrent loops do not pin their threads to the same CPUs
+bool concurrent_placement_test(const char * const name, const SpecLib::Affinity affinity)
+{ Placement_t placements[2];
+  std::atomic<int> started{0};
+  bool result_ok[2];
+
+  std::thread other([&] { result_ok[1] = placed_loop(affinity, placements[1], started, 2); });
+  result_ok[0] = placed_loop(affinity, placements[0], started, 2);
+  other.join();
+
+  std::multiset<int> cpus[2];
+  const bool pinned0 = placements[0].pinned_cpus(cpus[0]) && placements[0].pinned_seq_cpus(cpus[0]);
+  const bool pinned1 = placements[1].pinned_cpus(cpus[1]) && placements[1].pinned_seq_cpus(cpus[1]);
+  bool shared = false;
+  if (pinned0 && pinned1 && (process_cpus() > 1)) {
+    for (const int cpu : cpus[0]) {
+      shared = shared || cpus[1].count(cpu);
+    }
+  }
+  const bool test_ok = result_ok[0] && result_ok[1] && !shared;
+
+  std::cout << name << " concurrent placement: pinned " << (pinned0 ? 'Y' : 'N') << (pinned1 ? 'Y' : 'N') << " shared CPUs " << (shared ? 'Y' : 'N') << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  bool test_ok = affinity_test("Compact", SpecLib::Affinity::Compact) && affinity_test("Scatter", SpecLib::Affinity::Scatter) && affinity_test("List", SpecLib::Affinity::List);
+#ifdef __linux__
+  test_ok = test_ok && placement_test("Compact", SpecLib::Affinity::Compact) && placement_test("Scatter", SpecLib::Affinity::Scatter) &&
+            concurrent_placement_test("Compact", SpecLib::Affinity::Compact) && concurrent_placement_test("Scatter", SpecLib::Affinity::Scatter);
+#endif
+
+  return test_ok ? 0 : -1;
+}
@@ -0,0 +1,139 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     async_test.cpp
+/// \brief    Test on the asynchronous launch of speculative loops with specRunAsync
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int MaxSeq;
+int MinSeq;
+int *Vals;
+
+void seq_test()
+{ int max_seq = 0, min_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    if (Vals[i] > max_seq) {
+      max_seq = Vals[i];
+    }
+    if (Vals[i] < min_seq) {
+      min_seq = Vals[i];
+    }
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  MaxSeq = max_seq;
+  MinSeq = min_seq;
+
+  std::cout << "Seq   : " << max_seq << " " << min_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+static inline void sf_max(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+static inline void sf_min(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (Vals[iteration] < result) {
+    result = Vals[iteration];
+  }
+}
+
+/// Launches a loop in background while the calling thread runs another one
+bool overlap_test()
+{ bool test_ok = true;
+  double avg_time = 0.0;
+  size_t i;
+
+  const size_t calcChunk = SpecLib::getChunkSize(N, NChunks);
+  for (i = 0; (i < NReps) && test_ok; i++) {
+    int max_spec = 0, min_spec = 0, local_max = 0;
+
+    const auto tpar_begin = profile_clock_t::now();
+    SpecLib::SpecRunHandle h_max = SpecLib::specRunAsync(default_config(), 0, N, 1, calcChunk, sf_max, max_spec);
+    SpecLib::SpecRunHandle h_min = SpecLib::specRunAsync(default_config(), 0, N, 1, calcChunk, sf_min, min_spec);
+    for (size_t j = 0; j < N; j++) { // unrelated work in the calling thread
+      sf_max(j, local_max);
+    }
+    h_max.wait();
+    h_min.wait();
+    const auto tpar_end = profile_clock_t::now();
+    avg_time += std::chrono::duration<double>(tpar_end - tpar_begin).count();
+
+    test_ok = h_max.ready() && h_min.ready() && (max_spec == MaxSeq) && (min_spec == MinSeq) && (local_max == MaxSeq);
+
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+    printStatsRunInfo(h_max.stats());
+#endif
+
+    std::cout << "Async : " << max_spec << " " << min_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  }
+  avg_time /= static_cast<double>(i);
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The handle is destroyed without an explicit wait
+bool scope_test()
+{ int max_spec = 0;
+
+  {
+    auto handle = SpecLib::specRunAsync(default_config(), 0, N, 1, SpecLib::getChunkSize(N, NChunks), [](const size_t iteration, int& result) { sf_max(iteration, result); }, max_spec);
+  }
+
+  const bool test_ok = (max_spec == MaxSeq);
+
+  std::cout << "Scope : " << max_spec << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return overlap_test() && scope_test() ? 0 : -1;
+}
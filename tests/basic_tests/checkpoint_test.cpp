@@ -0,0 +1,175 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     checkpoint_test.cpp
+/// \brief    Test on the checkpoints of the sequential runs used to shorten the reruns after failed validations
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t RESET_PERIOD = 256;
+
+size_t N = 1000;
+unsigned ResultSeq;
+size_t SumSeq;
+unsigned *Vals;
+
+/// Every iteration depends on the previous one, but the state is reset periodically, so the reruns converge with the cancelled runs
+static inline void body(const size_t iteration, unsigned& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (!(iteration % RESET_PERIOD)) {
+    result = Vals[iteration];
+  } else {
+    result = result * 31u + Vals[iteration];
+  }
+}
+
+void seq_test()
+{ unsigned result_seq = 0;
+  size_t sum_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+    sum_seq += Vals[i];
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+  SumSeq = sum_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+unsigned result_spec;
+SpecLib::ReductionVar<size_t> red_spec((size_t)0, std::plus<size_t>());
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration checkpoint_config(const size_t interval)
+{
+  SpecLib::Configuration config = default_config();
+  config.checkpoint_interval_ = interval;
+  return config;
+}
+
+bool lambda_test(const size_t interval)
+{
+  const auto loop_f = [&](const size_t iteration, unsigned& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(checkpoint_config(interval), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda(" << interval << "): " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test(const size_t interval)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, unsigned& result) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  const bool test_ok = bench(checkpoint_config(interval), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda loop(" << interval << "): " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The speculative results of one in four chunks are spoiled, so their validations fail. The next chunks begin at
+///a reset of the state, so the reruns converge with the cancelled runs, which are slowed down to let them take
+///snapshots, and must resume from them, which is checked when the statistics are enabled
+bool salvage_test(const size_t interval)
+{ constexpr size_t ChunkSize = 3 * RESET_PERIOD;
+
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, unsigned& result) {
+    if (!cs.isParExec) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+    if (cs.isParExec && !(end % ChunkSize) && ((end / ChunkSize) % 4 == 1)) {
+      result++;
+    }
+  };
+
+  reset_result();
+#if defined(SLSTATS) || defined(SLMINIMALSTATS)
+  const SpecLib::StatsRunInfo stats = SpecLib::specRun(checkpoint_config(interval), 0, N, 1, ChunkSize, loop_f, result_spec);
+  const bool test_ok = test_f() && stats.salvaged;
+
+  std::cout << "Salvage(" << interval << "): " << result_spec << " resumes " << stats.salvaged << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+#else
+  SpecLib::specRun(checkpoint_config(interval), 0, N, 1, ChunkSize, loop_f, result_spec);
+  const bool test_ok = test_f();
+
+  std::cout << "Salvage(" << interval << "): " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+#endif
+
+  return test_ok;
+}
+
+/// The ReductionVar cannot be snapshotted, so the checkpoints are disabled
+bool reduction_test()
+{
+  const auto loop_f = [&](const size_t iteration, unsigned& result, SpecLib::ReductionVar<size_t>& red) {
+    body(iteration, result);
+    red.thread_val() += Vals[iteration];
+  };
+
+  const auto reset_f = [] () { result_spec = 0; red_spec.set(0); };
+  const auto red_test_f = [] () { return (result_spec == ResultSeq) && (red_spec.result() == SumSeq); };
+
+  const bool test_ok = bench(checkpoint_config(64), 0, N, 1, loop_f, reset_f, red_test_f, avg_time, result_spec, red_spec);
+
+  std::cout << "Reduction: " << result_spec << " " << red_spec.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new unsigned[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<unsigned>(0, std::numeric_limits<unsigned>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test(64) && lambda_test(1) && lambda_loop_test(64) && salvage_test(64) && reduction_test() ? 0 : -1;
+}
@@ -0,0 +1,122 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     concurrent_test.cpp
+/// \brief    Test on several threads running concurrently speculative loops of the same type
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NCallers = 3;
+
+size_t N = 1000;
+int MaxSeq[NCallers];
+int *Vals[NCallers];
+
+void seq_test()
+{
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t c = 0; c < NCallers; c++) {
+    int max_seq = 0;
+    for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+      mywait(DelaySeconds);
+#endif
+      if (Vals[c][i] > max_seq) {
+        max_seq = Vals[c][i];
+      }
+    }
+    MaxSeq[c] = max_seq;
+    std::cout << "Seq   : " << max_seq << std::endl;
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+/// All the callers use the same function, and thus the same internal types
+static inline void sf_max(const size_t iteration, const int * const vals, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (vals[iteration] > result) {
+    result = vals[iteration];
+  }
+}
+
+bool concurrent_test()
+{ bool test_ok = true;
+  double avg_time = 0.0;
+  size_t i;
+
+  const size_t calcChunk = SpecLib::getChunkSize(N, NChunks);
+  for (i = 0; (i < NReps) && test_ok; i++) {
+    int max_spec[NCallers] = {};
+    std::vector<std::thread> callers;
+
+    const auto tpar_begin = profile_clock_t::now();
+    for (size_t c = 0; c < NCallers; c++) {
+      callers.emplace_back([&, c]() {
+        const int * const vals = Vals[c];
+        SpecLib::specRun(default_config(), 0, N, 1, calcChunk, [vals](const size_t iteration, int& result) { sf_max(iteration, vals, result); }, max_spec[c]);
+      });
+    }
+    for (auto& caller : callers) {
+      caller.join();
+    }
+    const auto tpar_end = profile_clock_t::now();
+    avg_time += std::chrono::duration<double>(tpar_end - tpar_begin).count();
+
+    std::cout << "Conc  :";
+    for (size_t c = 0; c < NCallers; c++) {
+      test_ok = test_ok && (max_spec[c] == MaxSeq[c]);
+      std::cout << ' ' << max_spec[c];
+    }
+    // A loop alone can grow the pool to the threads it asks for, or up to the hardware threads,
+    //while the loops run concurrently with it get at least one thread and otherwise share the rest
+    const size_t hw_threads = std::thread::hardware_concurrency();
+    const size_t pool_threads = SpecLib::internal::SpecLibThreadPool().nthreads();
+    test_ok = test_ok && (!hw_threads || (pool_threads <= std::max(hw_threads, NThreads - 1) + NCallers - 1));
+    std::cout << ' ' << pool_threads << " threads " << (test_ok ? 'Y' : 'N') << std::endl;
+  }
+  avg_time /= static_cast<double>(i);
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t c = 0; c < NCallers; c++) {
+    Vals[c] = new int[N];
+    for (size_t i = 0; i < N; i++) {
+      Vals[c][i] = mt_rand_gen();
+    }
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return concurrent_test() ? 0 : -1;
+}
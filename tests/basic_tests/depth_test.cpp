@@ -0,0 +1,132 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     depth_test.cpp
+/// \brief    Test on the limit of the number of chunks whose sequential run is in flight
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <thread>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The first quarter of the loop carries a true dependence in some iterations, while the rest only computes a maximum
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if ((iteration < N / 4) && !(iteration % 64)) {
+    result = (result / 2) + (Vals[iteration] / 4);
+  } else if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+std::atomic<size_t> SeqRuns;    ///< Sequential runs of chunks in progress
+std::atomic<size_t> MaxSeqRuns; ///< Maximum number of sequential runs in progress at the same time in the last test
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration depth_config(const size_t depth)
+{
+  SpecLib::Configuration config = default_config();
+  config.max_spec_depth_ = depth;
+  return config;
+}
+
+bool depth_test(const size_t depth)
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(depth_config(depth), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Depth " << depth << ": " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Checks that the sequential runs in progress never exceed the depth, or that they overlap if there is no limit
+bool depth_loop_test(const size_t depth)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    if (!cs.isParExec) {
+      const size_t running = SeqRuns.fetch_add(1) + 1;
+      size_t max_running = MaxSeqRuns.load();
+      while ((max_running < running) && !MaxSeqRuns.compare_exchange_weak(max_running, running));
+      // Slowed down so that, without a limit, the next chunks start their sequential runs before it finishes
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+    if (!cs.isParExec) {
+      SeqRuns.fetch_sub(1);
+    }
+  };
+
+  SeqRuns.store(0);
+  MaxSeqRuns.store(0);
+  const bool test_ok = bench(depth_config(depth), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec) && (depth ? (MaxSeqRuns.load() <= depth) : (MaxSeqRuns.load() > 1));
+
+  std::cout << "Depth loop " << depth << ": " << result_spec << " " << MaxSeqRuns.load() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return depth_test(1) && depth_test(2) && depth_loop_test(1) && depth_loop_test(2) && depth_loop_test(0) ? 0 : -1;
+}
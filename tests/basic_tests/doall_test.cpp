@@ -0,0 +1,167 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     doall_test.cpp
+/// \brief    Test on the chunks that skip their sequential run after the loop behaves as a DOALL one
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <atomic>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int MaxSeq;
+int DepSeq;
+size_t DependentBegin, DependentEnd;
+std::atomic<size_t> SeqIterations; ///< Iterations run by the sequential runs of the chunks
+int *Vals;
+
+/// Maximum of the values, whose parallel runs give the same result as the sequential ones
+static inline void max_body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+/// Sum that carries a true dependence between the iterations from \c DependentBegin to \c DependentEnd.
+///\c prev is the value left by the previous iteration
+static inline void dep_body(const size_t iteration, int& dep, const int prev)
+{
+  if ((iteration >= DependentBegin) && (iteration < DependentEnd)) {
+    dep = prev + (Vals[iteration] % 1000);
+  }
+}
+
+void seq_test()
+{ int max_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    max_body(i, max_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  MaxSeq = max_seq;
+
+  std::cout << "Seq   : " << max_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+/// Places the dependence in \c nchunks chunks from the chunk \c first on, and computes its sequential result
+void place_dependence(const size_t first, const size_t nchunks)
+{ int dep_seq = 0;
+
+  const size_t chunk_size = SpecLib::getChunkSize(N, NChunks);
+  DependentBegin = std::min(first * chunk_size, N);
+  DependentEnd = std::min(DependentBegin + nchunks * chunk_size, N);
+  for (size_t i = 0; i < N; i++) {
+    dep_body(i, dep_seq, dep_seq);
+  }
+  DepSeq = dep_seq;
+}
+
+int result_spec;
+int dep_spec;
+double avg_time;
+
+SpecLib::Configuration doall_config()
+{
+  SpecLib::Configuration config = default_config();
+  config.doall_after_ = 2;
+  config.doall_probe_every_ = 2;
+  return config;
+}
+
+/// The sequential runs are slowed down so that the speculations are validated by comparing their results
+static inline void slow_sequential(const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end)
+{
+  if (!cs.isParExec) {
+    SeqIterations.fetch_add(end - begin);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+/// The loop is independent, so after a few chunks most of them skip their sequential run
+bool skip_test()
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    slow_sequential(cs, begin, end);
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      max_body(i, result);
+    }
+  };
+
+  const auto reset_f = [] () { result_spec = 0; SeqIterations = 0; };
+  const auto test_f = [] () { return (result_spec == MaxSeq) && (SeqIterations.load() < N); };
+
+  const bool test_ok = bench(doall_config(), 0, N, 1, loop_f, reset_f, test_f, avg_time, result_spec);
+
+  std::cout << "Skip  : " << result_spec << " " << SeqIterations.load() << " sequential iterations " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// A dependence appears in the middle of the loop, after the chunks began to skip their sequential run.
+///The parallel runs read the value of the variable at the beginning of their portion, as if the iterations
+///that write it before had not run yet. A probe finds the mismatch and the loop rolls back before the chunks
+///that skipped their sequential run, which may have got a wrong result too. The dependence begins at the
+///chunk \c first, so that trying consecutive chunks it begins both in a probe and in a chunk that skips it
+bool dependence_test(const size_t first)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result, int& dep) {
+    slow_sequential(cs, begin, end);
+    const int stale = dep;
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      max_body(i, result);
+      dep_body(i, dep, cs.isParExec ? stale : dep);
+    }
+  };
+
+  const auto reset_f = [] () { result_spec = 0; dep_spec = 0; SeqIterations = 0; };
+  const auto test_f = [] () { return (result_spec == MaxSeq) && (dep_spec == DepSeq); };
+
+  place_dependence(first, 4);
+  const bool test_ok = bench(doall_config(), 0, N, 1, loop_f, reset_f, test_f, avg_time, result_spec, dep_spec);
+
+  std::cout << "Dependence at chunk " << first << ": " << result_spec << " " << dep_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return skip_test() && dependence_test(NChunks / 2) && dependence_test(NChunks / 2 + 1) ? 0 : -1;
+}
@@ -0,0 +1,131 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     dynamic_test.cpp
+/// \brief    Test on the dynamic distribution of the parallel part of the chunks with an irregular loop
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The cost of the iterations grows along the loop, so an even split is unbalanced
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  int v = Vals[iteration];
+  for (size_t k = 0; k < ((iteration * 16) / N); k++) {
+    v = (v >> 1) ^ (v & 0xffff);
+  }
+  if (v > result) {
+    result = v;
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration dynamic_config()
+{
+  SpecLib::Configuration config = default_config();
+  config.dynamic_block_size_ = std::max(SpecLib::getChunkSize(N, NChunks) / (8 * NThreads), static_cast<size_t>(1));
+  return config;
+}
+
+bool lambda_test()
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(dynamic_config(), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test()
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  const bool test_ok = bench(dynamic_config(), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda loop: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool static_test()
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Static: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test() && lambda_loop_test() && static_test() ? 0 : -1;
+}
@@ -0,0 +1,113 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     fallback_test.cpp
+/// \brief    Test on the fallback to a sequential execution of loops whose speculation keeps failing
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+unsigned ResultSeq;
+unsigned *Vals;
+
+/// Every iteration depends on the previous one, so the speculation of every chunk fails
+static inline void body(const size_t iteration, unsigned& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  result = result * 31u + Vals[iteration];
+}
+
+void seq_test()
+{ unsigned result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+unsigned result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration fallback_config(const size_t probe_after)
+{
+  SpecLib::Configuration config = default_config();
+  config.fallback_failure_ratio_ = 0.5f;
+  config.fallback_window_ = 4;
+  config.fallback_probe_after_ = probe_after;
+  return config;
+}
+
+bool lambda_test(const size_t probe_after)
+{
+  const auto loop_f = [&](const size_t iteration, unsigned& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(fallback_config(probe_after), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda(" << probe_after << "): " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test(const size_t probe_after)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, unsigned& result) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  const bool test_ok = bench(fallback_config(probe_after), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Lambda loop(" << probe_after << "): " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new unsigned[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<unsigned>(0, std::numeric_limits<unsigned>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test(0) && lambda_test(N / 8) && lambda_loop_test(N / 8) ? 0 : -1;
+}
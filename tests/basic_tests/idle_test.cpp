@@ -0,0 +1,164 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     idle_test.cpp
+/// \brief    Test on the idle policies of the threads that wait for work
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <time.h>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The first quarter of the loop carries a true dependence in some iterations, while the rest only computes a maximum
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if ((iteration < N / 4) && !(iteration % 64)) {
+    result = (result / 2) + (Vals[iteration] / 4);
+  } else if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+SpecLib::Configuration idle_config(const size_t spins, const size_t yields)
+{
+  SpecLib::Configuration config = default_config();
+  config.idle_spins_ = spins;
+  config.idle_yields_ = yields;
+  return config;
+}
+
+bool idle_test(const char * const name, const size_t spins, const size_t yields)
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(idle_config(spins, yields), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << name << ": " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool idle_loop_test(const char * const name, const size_t spins, const size_t yields)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  const bool test_ok = bench(idle_config(spins, yields), 0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << name << " loop: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// CPU time in seconds consumed so far according to \c clock
+double cpu_time(const clockid_t clock)
+{ struct timespec ts;
+  clock_gettime(clock, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+/// CPU time consumed by the threads of the pool in a loop in which they run out of work in every chunk,
+///as its sequential run sleeps and no deeper speculation is allowed meanwhile
+double starved_loop_cpu_time(const size_t spins, const size_t yields, bool& test_ok)
+{
+  const auto loop_f = [](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, int& result) {
+    if (!cs.isParExec) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, result);
+    }
+  };
+
+  SpecLib::Configuration config = idle_config(spins, yields);
+  config.max_spec_depth_ = 1;
+
+  reset_result();
+  // The calling thread waits for the chunks polling, so it is left out of the measure
+  const double process_t0 = cpu_time(CLOCK_PROCESS_CPUTIME_ID), caller_t0 = cpu_time(CLOCK_THREAD_CPUTIME_ID);
+  SpecLib::specRun(config, 0, N, 1, SpecLib::getChunkSize(N, NChunks), loop_f, result_spec);
+  const double process_t1 = cpu_time(CLOCK_PROCESS_CPUTIME_ID), caller_t1 = cpu_time(CLOCK_THREAD_CPUTIME_ID);
+  test_ok = test_f();
+
+  return (process_t1 - process_t0) - (caller_t1 - caller_t0);
+}
+
+/// Checks that the idle workers block, using much less CPU than when they spin, and that the new chunks wake them up
+bool parking_test()
+{ bool spin_ok, block_ok;
+
+  const double spin_time = starved_loop_cpu_time(std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), spin_ok);
+  const double block_time = starved_loop_cpu_time(64, 16, block_ok);
+  const bool test_ok = spin_ok && block_ok && (block_time < spin_time / 2);
+
+  std::cout << "Parking: " << result_spec << " pool CPU time spinning " << spin_time << " blocking " << block_time << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return idle_test("Yield", 64, std::numeric_limits<size_t>::max()) && idle_test("Block", 64, 16) && idle_loop_test("Block", 0, 0) && parking_test() ? 0 : -1;
+}
@@ -0,0 +1,172 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     iter_test.cpp
+/// \brief    Test on loops that traverse ranges given by iterators and containers
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+constexpr int RAND_SEED = 981;
+
+struct Record {
+  int key;
+  double weight;
+};
+
+size_t N = 1000;
+int MaxSeq;
+std::vector<Record> Records;
+
+void seq_test()
+{ int max_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (const Record& r : Records) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    if (r.key > max_seq) {
+      max_seq = r.key;
+    }
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  MaxSeq = max_seq;
+
+  std::cout << "Seq   : " << max_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+using RecordIt = std::vector<Record>::const_iterator;
+
+static inline void sf_max(const RecordIt it, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (it->key > result) {
+    result = it->key;
+  }
+}
+
+/// Runs \c run_f, which launches a loop that leaves its result in its argument, NReps times
+template<typename FRun>
+bool run_test(const char * const name, const FRun& run_f)
+{ bool test_ok = true;
+  double avg_time = 0.0;
+  size_t i;
+
+  for (i = 0; (i < NReps) && test_ok; i++) {
+    int max_spec = 0;
+    const auto tpar_begin = profile_clock_t::now();
+    run_f(max_spec);
+    const auto tpar_end = profile_clock_t::now();
+    avg_time += std::chrono::duration<double>(tpar_end - tpar_begin).count();
+    test_ok = (max_spec == MaxSeq);
+    std::cout << name << max_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  }
+  avg_time /= static_cast<double>(i);
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool iterator_test()
+{
+  return run_test("Iterator: ", [](int& result) {
+    SpecLib::specRun(default_config(), Records.cbegin(), Records.cend(), SpecLib::getChunkSize(N, NChunks), sf_max, result);
+  });
+}
+
+bool chunk_test()
+{
+  const auto loop_f = [](const SpecLib::ExCommonSpecInfo_t& cs, const RecordIt begin, const RecordIt end, const std::ptrdiff_t step, int& result) {
+    for (RecordIt it = begin; (it < end) && !cs.cancelled(); it += step) {
+      sf_max(it, result);
+    }
+  };
+
+  return run_test("Chunk : ", [&](int& result) {
+    SpecLib::specRun(default_config(), Records.cbegin(), Records.cend(), SpecLib::getChunkSize(N, NChunks), loop_f, result);
+  });
+}
+
+bool pointer_test()
+{
+  return run_test("Pointer: ", [](int& result) {
+    const Record * const p = Records.data();
+    SpecLib::specRun(default_config(), p, p + N, SpecLib::getChunkSize(N, NChunks), [](const Record * const r, int& res) {
+#ifdef ENABLE_DELAY
+      mywait(DelaySeconds);
+#endif
+      if (r->key > res) {
+        res = r->key;
+      }
+    }, result);
+  });
+}
+
+bool container_test()
+{
+  return run_test("Container: ", [](int& result) {
+    SpecLib::specRun(default_config(), Records, SpecLib::getChunkSize(N, NChunks), [](const std::vector<Record>::iterator it, int& res) {
+      sf_max(it, res);
+    }, result);
+  });
+}
+
+#if __cplusplus >= 202002L
+bool span_test()
+{
+  return run_test("Span  : ", [](int& result) {
+    SpecLib::specRun(default_config(), std::span<const Record>(Records), SpecLib::getChunkSize(N, NChunks), [](const std::span<const Record>::iterator it, int& res) {
+#ifdef ENABLE_DELAY
+      mywait(DelaySeconds);
+#endif
+      if (it->key > res) {
+        res = it->key;
+      }
+    }, result);
+  });
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Records.resize(N);
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Records[i] = {mt_rand_gen(), static_cast<double>(i)};
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  bool test_ok = iterator_test() && chunk_test() && pointer_test() && container_test();
+#if __cplusplus >= 202002L
+  test_ok = test_ok && span_test();
+#endif
+
+  return test_ok ? 0 : -1;
+}
@@ -0,0 +1,114 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     lifecycle_test.cpp
+/// \brief    Test on the explicit control of the threads kept by the runtime
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int ResultSeq;
+int *Vals;
+
+/// The first quarter of the loop carries a true dependence in some iterations, while the rest only computes a maximum
+static inline void body(const size_t iteration, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if ((iteration < N / 4) && !(iteration % 64)) {
+    result = (result / 2) + (Vals[iteration] / 4);
+  } else if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+/// Runs the loop and checks the number of threads left in the pool
+bool lifecycle_test(const char * const name, const size_t expected_pool_threads)
+{
+  const auto loop_f = [&](const size_t iteration, int& result) {
+    body(iteration, result);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+  const size_t pool_threads = SpecLib::internal::SpecLibThreadPool().nthreads();
+
+  std::cout << name << ": " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok && (pool_threads == expected_pool_threads);
+}
+
+/// Shrinks the pool and checks the number of threads left in it
+bool shrink_test(const char * const name, const size_t nthreads, const size_t expected_pool_threads)
+{
+  if (nthreads) {
+    SpecLib::reinit(nthreads);
+  } else {
+    SpecLib::shutdown();
+  }
+  const size_t pool_threads = SpecLib::internal::SpecLibThreadPool().nthreads();
+  const bool test_ok = (pool_threads == expected_pool_threads);
+
+  std::cout << name << ": " << pool_threads << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  SpecLib::init(NThreads);
+
+  do_preheat(); // Preheat
+
+  const size_t pool_threads = std::max(NThreads, static_cast<size_t>(3)) - 1;
+  return lifecycle_test("Init", pool_threads) && shrink_test("Shutdown", 0, 0) &&
+         lifecycle_test("Lazy", pool_threads) && shrink_test("Reinit", 2, std::min(pool_threads, static_cast<size_t>(1))) ? 0 : -1;
+}
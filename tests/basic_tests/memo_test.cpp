@@ -0,0 +1,138 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     memo_test.cpp
+/// \brief    Test on the memoization of the results of the sequential runs of the chunks
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+constexpr unsigned NStates = 4;
+
+size_t N = 1000;
+unsigned StateSeq;
+size_t CountSeq;
+unsigned *Vals;
+
+/// Small state machine whose transitions depend on the previous state, counting the visits to state 0
+static inline void body(const size_t iteration, unsigned& state, size_t& count)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  state = (state * 3u + Vals[iteration]) % NStates;
+  count += !state;
+}
+
+void seq_test()
+{ unsigned state_seq = 0;
+  size_t count_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    body(i, state_seq, count_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  StateSeq = state_seq;
+  CountSeq = count_seq;
+
+  std::cout << "Seq   : " << state_seq << " " << count_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+unsigned state_spec;
+size_t count_spec;
+SpecLib::ReductionVar<size_t> red_spec((size_t)0, std::plus<size_t>());
+double avg_time;
+
+const auto reset_result = [] () { state_spec = 0; count_spec = 0; };
+const auto test_f = [] () { return (state_spec == StateSeq) && (count_spec == CountSeq); };
+
+SpecLib::Configuration memo_config(const size_t capacity)
+{
+  SpecLib::Configuration config = default_config();
+  config.memo_capacity_ = capacity;
+  return config;
+}
+
+bool lambda_test(const size_t capacity)
+{
+  const auto loop_f = [&](const size_t iteration, unsigned& state, size_t& count) {
+    body(iteration, state, count);
+  };
+
+  const bool test_ok = bench(memo_config(capacity), 0, N, 1, loop_f, reset_result, test_f, avg_time, state_spec, count_spec);
+
+  std::cout << "Lambda(" << capacity << "): " << state_spec << " " << count_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test(const size_t capacity)
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, unsigned& state, size_t& count) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, state, count);
+    }
+  };
+
+  const bool test_ok = bench(memo_config(capacity), 0, N, 1, loop_f, reset_result, test_f, avg_time, state_spec, count_spec);
+
+  std::cout << "Lambda loop(" << capacity << "): " << state_spec << " " << count_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The ReductionVar cannot be compared by value, so the memoization is disabled
+bool reduction_test()
+{
+  const auto loop_f = [&](const size_t iteration, unsigned& state, SpecLib::ReductionVar<size_t>& red) {
+    size_t count = 0;
+    body(iteration, state, count);
+    red.thread_val() += count;
+  };
+
+  const auto reset_f = [] () { state_spec = 0; red_spec.set(0); };
+  const auto red_test_f = [] () { return (state_spec == StateSeq) && (red_spec.result() == CountSeq); };
+
+  const bool test_ok = bench(memo_config(64), 0, N, 1, loop_f, reset_f, red_test_f, avg_time, state_spec, red_spec);
+
+  std::cout << "Reduction: " << state_spec << " " << red_spec.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new unsigned[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<unsigned>(0, std::numeric_limits<unsigned>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test(64) && lambda_test(1) && lambda_loop_test(64) && reduction_test() ? 0 : -1;
+}
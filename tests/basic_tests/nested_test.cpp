@@ -0,0 +1,110 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     nested_test.cpp
+/// \brief    Test on speculative loops run inside the body of another speculative loop
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NRows = 32;
+
+size_t N = 1000;
+size_t NCols;
+int ResultSeq;
+int *Vals;
+
+/// Maximum of a row
+static inline void inner_body(const size_t iteration, const int * const row, int& result)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (row[iteration] > result) {
+    result = row[iteration];
+  }
+}
+
+/// Some rows make the outer loop carry a true dependence
+static inline void outer_combine(const size_t row, const int row_max, int& result)
+{
+  if (!(row % 8)) {
+    result = (result / 2) + (row_max / 4);
+  } else if (row_max > result) {
+    result = row_max;
+  }
+}
+
+void seq_test()
+{ int result_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t r = 0; r < NRows; r++) {
+    int row_max = 0;
+    for (size_t i = 0; i < NCols; i++) {
+      inner_body(i, Vals + r * NCols, row_max);
+    }
+    outer_combine(r, row_max, result_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  ResultSeq = result_seq;
+
+  std::cout << "Seq   : " << result_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+int result_spec;
+double avg_time;
+
+const auto reset_result = [] () { result_spec = 0; };
+const auto test_f = [] () { return (result_spec == ResultSeq); };
+
+bool nested_test()
+{
+  const auto loop_f = [&](const size_t r, int& result) {
+    const int * const row = Vals + r * NCols;
+    int row_max = 0;
+    SpecLib::specRun(default_config(), 0, NCols, 1, SpecLib::getChunkSize(NCols, NChunks), [row](const size_t iteration, int& inner_result) { inner_body(iteration, row, inner_result); }, row_max);
+    outer_combine(r, row_max, result);
+  };
+
+  const bool test_ok = bench(0, NRows, 1, loop_f, reset_result, test_f, avg_time, result_spec);
+
+  std::cout << "Nested: " << result_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  NCols = std::max(N / NRows, static_cast<size_t>(1));
+  Vals = new int[NRows * NCols];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < NRows * NCols; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return nested_test() ? 0 : -1;
+}
@@ -0,0 +1,177 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     predict_test.cpp
+/// \brief    Test on the prediction of the values of SpecPredicted variables at the beginning of the chunks
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+constexpr long STRIDE = 3;
+
+size_t N = 1000;
+long CountSeq;
+int MaxSeq;
+int LastSeq;
+int *Vals;
+
+using Counter_t = SpecLib::SpecPredicted<long>;
+
+/// Position of the counter after \c iteration
+static inline void count_body(const size_t iteration, long& count)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  static_cast<void>(iteration);
+  count += STRIDE;
+}
+
+/// Maximum of the values, which the parallel runs already speculate well
+static inline void max_body(const size_t iteration, int& result)
+{
+  if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+/// Variable that only changes in a few iterations
+static inline void last_body(const size_t iteration, int& last)
+{
+  if (!(iteration % (N / 4 + 1))) {
+    last = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ long count_seq = 0;
+  int max_seq = 0;
+  int last_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    count_body(i, count_seq);
+    max_body(i, max_seq);
+    last_body(i, last_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  CountSeq = count_seq;
+  MaxSeq = max_seq;
+  LastSeq = last_seq;
+
+  std::cout << "Seq   : " << count_seq << " " << max_seq << " " << last_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+Counter_t count_spec;
+int max_spec;
+double avg_time;
+
+const auto reset_result = [] () { count_spec.set(0); max_spec = 0; };
+const auto test_f = [] () { return (count_spec.value() == CountSeq) && (max_spec == MaxSeq); };
+
+bool stride_test()
+{
+  const auto loop_f = [&](const size_t iteration, Counter_t& count, int& result) {
+    count_body(iteration, count.value());
+    max_body(iteration, result);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, count_spec, max_spec);
+
+  std::cout << "Stride: " << count_spec.value() << " " << max_spec << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_predictor_test()
+{
+  Counter_t count(0, [](const Counter_t::History& history, const long& speculated, const long long iteration) {
+    return history.empty() ? speculated : (history[0].value + STRIDE * static_cast<long>(iteration - history[0].iteration));
+  });
+
+  const auto loop_f = [&](const size_t iteration, Counter_t& count) {
+    count_body(iteration, count.value());
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, [&count] () { count.set(0); }, [&count] () { return count.value() == CountSeq; }, avg_time, count);
+
+  std::cout << "Lambda predictor: " << count.value() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The predictions are always wrong, so the validations must detect them and the chunks must rerun
+bool wrong_predictor_test()
+{
+  Counter_t count(0, [](const Counter_t::History& history, const long& speculated, const long long iteration) {
+    static_cast<void>(history);
+    static_cast<void>(iteration);
+    return speculated + 1000;
+  });
+
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, Counter_t& count) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      count_body(i, count.value());
+    }
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, [&count] () { count.set(0); }, [&count] () { return count.value() == CountSeq; }, avg_time, count);
+
+  std::cout << "Wrong predictor: " << count.value() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool last_value_test()
+{
+  SpecLib::SpecPredicted<int> last(0, SpecLib::LastValuePredictor());
+
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, SpecLib::SpecPredicted<int>& last) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      last_body(i, last.value());
+    }
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, [&last] () { last.set(0); }, [&last] () { return last.value() == LastSeq; }, avg_time, last);
+
+  std::cout << "Last value: " << last.value() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return stride_test() && lambda_predictor_test() && wrong_predictor_test() && last_value_test() ? 0 : -1;
+}
@@ -0,0 +1,118 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     reduction_array_test.cpp
+/// \brief    Test on support of ReductionArray and ReductionVector with histograms
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NBins = 16;
+constexpr size_t NVecBins = 100;
+
+size_t N = 1000;
+std::array<size_t, NBins> HistSeq;
+std::vector<int> MaxSeq;
+int *Vals;
+
+static inline size_t bin(const int val) { return static_cast<unsigned>(val) % NBins; }
+
+static inline size_t vec_bin(const int val) { return static_cast<unsigned>(val) % NVecBins; }
+
+void seq_test()
+{ std::array<size_t, NBins> hist_seq{};
+  std::vector<int> max_seq(NVecBins, std::numeric_limits<int>::min());
+
+  const auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    hist_seq[bin(Vals[i])]++;
+    max_seq[vec_bin(Vals[i])] = std::max(max_seq[vec_bin(Vals[i])], Vals[i]);
+  }
+  const auto tseq_end = profile_clock_t::now();
+
+  HistSeq = hist_seq;
+  MaxSeq = max_seq;
+
+  std::cout << "Seq   : " << hist_seq[0] << " " << max_seq[0] << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+SpecLib::ReductionArray<size_t, NBins> red_hist(std::array<size_t, NBins>{});
+SpecLib::ReductionVector<int, SpecLib::Max> red_max(std::vector<int>(NVecBins, std::numeric_limits<int>::min()));
+double avg_time;
+
+const auto reset_result = [] () { red_hist.set(std::array<size_t, NBins>{}); red_max.set(std::vector<int>(NVecBins, std::numeric_limits<int>::min())); };
+const auto test_f = [] () { return (red_hist.result() == HistSeq) && (red_max.result() == MaxSeq); };
+
+bool lambda_test()
+{
+  const auto loop_f = [&](const size_t iteration, SpecLib::ReductionArray<size_t, NBins>& red_hist, SpecLib::ReductionVector<int, SpecLib::Max>& red_max) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    red_hist.thread_val()[bin(Vals[iteration])]++;
+    int& max_val = red_max.thread_val()[vec_bin(Vals[iteration])];
+    max_val = std::max(max_val, Vals[iteration]);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, red_hist, red_max);
+
+  std::cout << "Lambda: " << red_hist.result()[0] << " " << red_max.result()[0] << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+static inline void sf(const size_t iteration, SpecLib::ReductionArray<size_t, NBins>& red_hist, SpecLib::ReductionVector<int, SpecLib::Max>& red_max)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  red_hist.thread_val()[bin(Vals[iteration])]++;
+  int& max_val = red_max.thread_val()[vec_bin(Vals[iteration])];
+  max_val = std::max(max_val, Vals[iteration]);
+}
+
+bool sf_test()
+{
+  const bool test_ok = bench(0, N, 1, sf, reset_result, test_f, avg_time, red_hist, red_max);
+
+  std::cout << "SF    : " << red_hist.result()[0] << " " << red_max.result()[0] << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test() && sf_test() ? 0 : -1;
+}
@@ -0,0 +1,201 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     reduction_contention_test.cpp
+/// \brief    Test on the lock-free reduction of ReductionVar when many threads publish their partial results at the same time
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t Rounds = 200;       ///< Rounds of reductions collected by the main thread
+constexpr size_t ReducesPerRound = 8; ///< Partial results published by each thread in each round
+
+size_t N = 1000;
+size_t SumSeq;
+int *Vals;
+
+void seq_test()
+{ size_t sum_seq = 0;
+
+  const auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    sum_seq += Vals[i];
+  }
+  const auto tseq_end = profile_clock_t::now();
+
+  SumSeq = sum_seq;
+
+  std::cout << "Seq   : " << sum_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+/// Barrier for a fixed number of threads that can be reused
+class Barrier_t {
+  const size_t nthreads_;
+  std::atomic<size_t> arrived_;
+  std::atomic<size_t> generation_;
+
+public:
+
+  Barrier_t(const size_t nthreads) :
+  nthreads_{nthreads},
+  arrived_{0},
+  generation_{0}
+  { }
+
+  void wait()
+  {
+    const size_t generation = generation_.load();
+    if (arrived_.fetch_add(1) + 1 == nthreads_) {
+      arrived_.store(0);
+      generation_.fetch_add(1);
+    } else {
+      while (generation_.load() == generation) {
+        std::this_thread::yield();
+      }
+    }
+  }
+};
+
+/// Runs \c nthreads threads that publish partial results of \c red at the same time, which the main thread collects
+///in each round while the threads wait, as their partial results live in their storage until then
+template<typename T, typename Op, typename F>
+void contended_rounds(SpecLib::ReductionVar<T, Op>& red, const size_t nthreads, const F& accumulate)
+{ Barrier_t barrier(nthreads + 1);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < nthreads; t++) {
+    threads.emplace_back([&, t] {
+      for (size_t round = 0; round < Rounds; round++) {
+        barrier.wait(); // all the threads start publishing at the same time
+        for (size_t k = 0; k < ReducesPerRound; k++) {
+          red.initialize();
+          accumulate(red.thread_val(), t, round, k);
+          red.reduce();
+        }
+        barrier.wait();
+        barrier.wait(); // collected
+      }
+    });
+  }
+  for (size_t round = 0; round < Rounds; round++) {
+    barrier.wait();
+    barrier.wait();
+    red.collect();
+    barrier.wait();
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+/// Many threads reduce many times into one variable, and the result must match the sequential one
+bool sum_test(const size_t nthreads)
+{ SpecLib::ReductionVar<size_t, SpecLib::Sum> red((size_t)0);
+  size_t sum_seq = 0;
+
+  const auto accumulate = [](size_t& v, const size_t t, const size_t round, const size_t k) {
+    v += Vals[(t * Rounds * ReducesPerRound + round * ReducesPerRound + k) % N];
+  };
+  for (size_t t = 0; t < nthreads; t++) {
+    for (size_t round = 0; round < Rounds; round++) {
+      for (size_t k = 0; k < ReducesPerRound; k++) {
+        accumulate(sum_seq, t, round, k);
+      }
+    }
+  }
+
+  contended_rounds(red, nthreads, accumulate);
+  const bool test_ok = (red.result() == sum_seq);
+
+  std::cout << "Sum   : " << red.result() << " " << sum_seq << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The concatenation is not commutative, so it checks that the partial results are folded after the accumulated ones.
+///The threads are folded in any order, but the pieces of each thread must remain together and in the order it published them
+bool concat_test(const size_t nthreads)
+{ const std::function<std::string(const std::string&, const std::string&)> concat = [](const std::string& a, const std::string& b) { return a + b; };
+  SpecLib::ReductionVar<std::string> red(std::string(), concat);
+
+  const auto accumulate = [](std::string& v, const size_t t, const size_t, const size_t k) {
+    v += static_cast<char>('A' + t % 26);
+    v += static_cast<char>('0' + k);
+  };
+
+  contended_rounds(red, nthreads, accumulate);
+
+  const std::string& result = red.result();
+  bool test_ok = (result.size() == nthreads * Rounds * ReducesPerRound * 2);
+  for (size_t i = 0; test_ok && (i < result.size()); i += 2 * ReducesPerRound) {
+    for (size_t k = 0; k < ReducesPerRound; k++) {
+      test_ok = test_ok && (result[i + 2 * k] == result[i]) && (result[i + 2 * k + 1] == static_cast<char>('0' + k));
+    }
+  }
+
+  std::cout << "Concat: " << result.size() << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Speculative loop with more threads than usual and small chunks, so that many threads finish their portions together
+bool loop_test(const size_t nthreads)
+{ SpecLib::ReductionVar<size_t, SpecLib::Sum> red((size_t)0);
+  double avg_time;
+
+  const auto loop_f = [&](const size_t iteration, SpecLib::ReductionVar<size_t, SpecLib::Sum>& red) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    red.thread_val() += Vals[iteration];
+  };
+
+  SpecLib::Configuration config = default_config();
+  config.nthreads_ = nthreads;
+  const bool test_ok = bench(config, 0, N, 1, loop_f, [&red] () { red.set(0); }, [&red] () { return red.result() == SumSeq; }, avg_time, red);
+
+  std::cout << "Loop  : " << red.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max() / 2), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  const size_t nthreads = std::max(NThreads, static_cast<size_t>(2)) * 4;
+  return sum_test(nthreads) && concat_test(nthreads) && loop_test(nthreads) ? 0 : -1;
+}
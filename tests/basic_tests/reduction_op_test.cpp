@@ -0,0 +1,123 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     reduction_op_test.cpp
+/// \brief    Test on support of ReductionVar with compile-time reduction operators
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+size_t SumSeq;
+int MaxSeq;
+unsigned XorSeq;
+int *Vals;
+
+void seq_test()
+{ size_t sum_seq = 0;
+  int max_seq = std::numeric_limits<int>::min();
+  unsigned xor_seq = 0;
+
+  const auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    sum_seq += Vals[i];
+    max_seq = std::max(max_seq, Vals[i]);
+    xor_seq ^= static_cast<unsigned>(Vals[i]);
+  }
+  const auto tseq_end = profile_clock_t::now();
+
+  SumSeq = sum_seq;
+  MaxSeq = max_seq;
+  XorSeq = xor_seq;
+
+  std::cout << "Seq   : " << sum_seq << " " << max_seq << " " << xor_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+#if __cplusplus >= 202002L
+const auto xor_f = [](const unsigned a, const unsigned b) { return a ^ b; }; // stateless lambdas are default constructible since C++20
+#else
+const SpecLib::BitXor xor_f;
+#endif
+
+SpecLib::ReductionVar<size_t, SpecLib::Sum> red_sum((size_t)0);
+SpecLib::ReductionVar<int, SpecLib::Max> red_max(std::numeric_limits<int>::min());
+SpecLib::ReductionVar<unsigned, decltype(xor_f)> red_xor(0u, xor_f);
+double avg_time;
+
+const auto reset_result = [] () { red_sum.set(0); red_max.set(std::numeric_limits<int>::min()); red_xor.set(0); };
+const auto test_f = [] () { return (red_sum.result() == SumSeq) && (red_max.result() == MaxSeq) && (red_xor.result() == XorSeq); };
+
+bool lambda_test()
+{
+  const auto loop_f = [&](const size_t iteration, SpecLib::ReductionVar<size_t, SpecLib::Sum>& red_sum, SpecLib::ReductionVar<int, SpecLib::Max>& red_max, SpecLib::ReductionVar<unsigned, decltype(xor_f)>& red_xor) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    red_sum.thread_val() += Vals[iteration];
+    red_max.thread_val() = std::max(red_max.thread_val(), Vals[iteration]);
+    red_xor.thread_val() ^= static_cast<unsigned>(Vals[iteration]);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, red_sum, red_max, red_xor);
+
+  std::cout << "Lambda: " << red_sum.result() << " " << red_max.result() << " " << red_xor.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+static inline void sf(const size_t iteration, SpecLib::ReductionVar<size_t, SpecLib::Sum>& red_sum, SpecLib::ReductionVar<int, SpecLib::Max>& red_max, SpecLib::ReductionVar<unsigned, decltype(xor_f)>& red_xor)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  red_sum.thread_val() += Vals[iteration];
+  red_max.thread_val() = std::max(red_max.thread_val(), Vals[iteration]);
+  red_xor.thread_val() ^= static_cast<unsigned>(Vals[iteration]);
+}
+
+bool sf_test()
+{
+  const bool test_ok = bench(0, N, 1, sf, reset_result, test_f, avg_time, red_sum, red_max, red_xor);
+
+  std::cout << "SF    : " << red_sum.result() << " " << red_max.result() << " " << red_xor.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return lambda_test() && sf_test() ? 0 : -1;
+}
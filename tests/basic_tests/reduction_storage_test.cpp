@@ -0,0 +1,162 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     reduction_storage_test.cpp
+/// \brief    Test on the growable per-thread storage of ReductionVar, with more variables than a block of slots and threads that come and go
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NVars = 100; ///< More than the slots in a block of each thread
+
+using Red_t = SpecLib::ReductionVar<size_t, SpecLib::Sum>;
+
+size_t N = 1000;
+size_t SumSeq;
+int *Vals;
+
+void seq_test()
+{ size_t sum_seq = 0;
+
+  const auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    sum_seq += Vals[i];
+  }
+  const auto tseq_end = profile_clock_t::now();
+
+  SumSeq = sum_seq;
+
+  std::cout << "Seq   : " << sum_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+std::vector<Red_t> vars;
+double avg_time;
+
+/// Whether the partial result of the calling thread for \c v is in a cache line of its own
+bool aligned_slot(const Red_t& v)
+{
+  return !(reinterpret_cast<std::uintptr_t>(&v.thread_val()) % 64);
+}
+
+/// Each of \c nthreads new threads adds its contribution to all the variables, which are collected before the threads exit
+bool threads_test(const char * const name, const size_t nthreads)
+{ std::atomic<size_t> reduced{0};
+  std::atomic<bool> collected{false};
+  std::atomic<bool> aligned{true};
+  std::vector<std::thread> threads;
+
+  for (auto& v : vars) {
+    v.set(0);
+  }
+  for (size_t t = 0; t < nthreads; t++) {
+    threads.emplace_back([&, t] {
+      for (size_t j = 0; j < vars.size(); j++) {
+        vars[j].initialize();
+        vars[j].thread_val() += t * 1000 + j;
+        if (!aligned_slot(vars[j])) {
+          aligned = false;
+        }
+        vars[j].reduce();
+      }
+      reduced.fetch_add(1);
+      // the partial results live in the storage of the thread until they are collected
+      while (!collected.load()) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (reduced.load() < nthreads) {
+    std::this_thread::yield();
+  }
+  for (auto& v : vars) {
+    v.collect();
+  }
+  collected = true;
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  bool test_ok = aligned.load();
+  for (size_t j = 0; j < vars.size(); j++) {
+    test_ok = test_ok && (vars[j].result() == (nthreads * (nthreads - 1) / 2) * 1000 + nthreads * j);
+  }
+
+  std::cout << name << ": " << nthreads << " threads " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Runs a loop that reduces in the variable whose slots are in the last block
+bool loop_test(const char * const name)
+{ Red_t& red = vars.back();
+
+  const auto loop_f = [&](const size_t iteration, Red_t& red) {
+#ifdef ENABLE_DELAY
+    mywait(DelaySeconds);
+#endif
+    red.thread_val() += Vals[iteration];
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, [&red] () { red.set(0); }, [&red] () { return red.result() == SumSeq; }, avg_time, red) && aligned_slot(red);
+
+  std::cout << name << ": " << red.result() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Destroys half of the variables and creates new ones, which reuse the slots they released
+void renew_vars()
+{
+  vars.resize(NVars / 2);
+  while (vars.size() < NVars) {
+    vars.emplace_back(static_cast<size_t>(0));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max() / 2), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  vars.reserve(NVars);
+  for (size_t j = 0; j < NVars; j++) {
+    vars.emplace_back(static_cast<size_t>(0));
+  }
+
+  do_preheat(); // Preheat
+
+  const size_t nthreads = std::max(NThreads, static_cast<size_t>(2)) * 4;
+  const bool first_ok = threads_test("Threads", nthreads) && loop_test("Loop");
+  renew_vars();
+  return first_ok && threads_test("Reused", nthreads) && threads_test("Fewer", 2) && loop_test("Reused loop") ? 0 : -1;
+}
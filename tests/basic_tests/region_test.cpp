@@ -0,0 +1,141 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     region_test.cpp
+/// \brief    Test on loops run many times through a Region that keeps their resources
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <vector>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NSteps = 8;
+constexpr size_t NBins = 64;
+
+size_t N = 1000;
+int *Vals;
+std::vector<int> MaxSeq;
+std::vector<long> HistSeq;
+
+/// Body of the time step \c t, which keeps the maximum of the shifted values and their histogram
+static inline void step_body(const size_t iteration, const size_t t, int& max, std::vector<long>& hist)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  const int v = Vals[(iteration + t) % N];
+  if (v > max) {
+    max = v;
+  }
+  hist[static_cast<size_t>(v) % NBins]++;
+}
+
+void seq_test()
+{ std::vector<long> hist(NBins, 0);
+
+  auto tseq_begin = profile_clock_t::now();
+  MaxSeq.assign(NSteps, 0);
+  for (size_t t = 0; t < NSteps; t++) {
+    for (size_t i = 0; i < N; i++) {
+      step_body(i, t, MaxSeq[t], hist);
+    }
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  HistSeq = hist;
+
+  std::cout << "Seq   : " << MaxSeq[NSteps - 1] << " " << hist[0] << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+/// Runs the time steps through \c region, or without region if it is nullptr
+bool steps_test(const char * const name, SpecLib::Region * const region)
+{ bool test_ok = true;
+  double avg_time = 0.0;
+  size_t i;
+
+  const size_t calcChunk = SpecLib::getChunkSize(N, NChunks);
+  for (i = 0; (i < NReps) && test_ok; i++) {
+    std::vector<long> hist(NBins, 0);
+    const auto tpar_begin = profile_clock_t::now();
+    for (size_t t = 0; (t < NSteps) && test_ok; t++) {
+      int max = 0;
+      const auto loop_f = [t](const size_t iteration, int& result, std::vector<long>& result_hist) {
+        step_body(iteration, t, result, result_hist);
+      };
+      if (region != nullptr) {
+        region->specRun(default_config(), 0, N, 1, calcChunk, loop_f, max, hist);
+      } else {
+        SpecLib::specRun(default_config(), 0, N, 1, calcChunk, loop_f, max, hist);
+      }
+      test_ok = (max == MaxSeq[t]);
+    }
+    const auto tpar_end = profile_clock_t::now();
+    avg_time += std::chrono::duration<double>(tpar_end - tpar_begin).count();
+    test_ok = test_ok && (hist == HistSeq);
+  }
+  avg_time /= static_cast<double>(i);
+
+  std::cout << name << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Loops of different types, including reverse ones, run through the same region
+bool mixed_test()
+{ SpecLib::Region region(NThreads);
+  bool test_ok = true;
+
+  const size_t calcChunk = SpecLib::getChunkSize(N, NChunks);
+  for (size_t t = 0; (t < NSteps) && test_ok; t++) {
+    int max = 0, max_rev = 0;
+    std::vector<long> hist(NBins, 0), hist_rev(NBins, 0);
+    region.specRun(default_config(), 0, N, 1, calcChunk, [t](const size_t iteration, int& result, std::vector<long>& result_hist) {
+      step_body(iteration, t, result, result_hist);
+    }, max, hist);
+    region.specRun(default_config(), static_cast<long>(N) - 1, -1L, -1L, calcChunk, [t](const long iteration, int& result, std::vector<long>& result_hist) {
+      step_body(static_cast<size_t>(iteration), t, result, result_hist);
+    }, max_rev, hist_rev);
+    test_ok = (max == MaxSeq[t]) && (max_rev == MaxSeq[t]) && (hist == hist_rev);
+    if (t == NSteps / 2) {
+      region.clear();
+    }
+  }
+
+  std::cout << "Mixed : " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  SpecLib::Region region(NThreads);
+
+  return steps_test("No region: ", nullptr) && steps_test("Region: ", &region) && mixed_test() ? 0 : -1;
+}
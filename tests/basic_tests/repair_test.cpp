@@ -0,0 +1,164 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     repair_test.cpp
+/// \brief    Test on the repair of SpecRepairable variables in chunks that started from wrong speculated values
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <thread>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+long SumSeq;
+int MaxSeq;
+long CountSeq;
+int *Vals;
+
+using Sum_t = SpecLib::SpecRepairable<long, SpecLib::AdditiveRepair>;
+using Max_t = SpecLib::SpecRepairable<int, SpecLib::MaxRepair>;
+using Count_t = SpecLib::SpecRepairable<long>;
+
+/// Running sum, which changes in every iteration, so its speculated values are always wrong
+static inline void sum_body(const size_t iteration, long& sum)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  sum += Vals[iteration] % 1000;
+}
+
+static inline void max_body(const size_t iteration, int& result)
+{
+  if (Vals[iteration] > result) {
+    result = Vals[iteration];
+  }
+}
+
+/// Counter of the even values
+static inline void count_body(const size_t iteration, long& count)
+{
+  count += !(Vals[iteration] & 1);
+}
+
+void seq_test()
+{ long sum_seq = 0;
+  int max_seq = 0;
+  long count_seq = 0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    sum_body(i, sum_seq);
+    max_body(i, max_seq);
+    count_body(i, count_seq);
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  SumSeq = sum_seq;
+  MaxSeq = max_seq;
+  CountSeq = count_seq;
+
+  std::cout << "Seq   : " << sum_seq << " " << max_seq << " " << count_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+Sum_t sum_spec;
+Max_t max_spec;
+double avg_time;
+
+const auto reset_result = [] () { sum_spec.set(0); max_spec.set(0); };
+const auto test_f = [] () { return (sum_spec.value() == SumSeq) && (max_spec.value() == MaxSeq); };
+
+bool builtin_repair_test()
+{
+  const auto loop_f = [&](const size_t iteration, Sum_t& sum, Max_t& result) {
+    sum_body(iteration, sum.value());
+    max_body(iteration, result.value());
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, sum_spec, max_spec);
+
+  std::cout << "Builtin: " << sum_spec.value() << " " << max_spec.value() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_repair_test()
+{
+  Count_t count(0, [](const long& true_start, const long& spec_start, const long& spec_end) {
+    return spec_end - spec_start + true_start;
+  });
+
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, Count_t& count) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      count_body(i, count.value());
+    }
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, [&count] () { count.set(0); }, [&count] () { return count.value() == CountSeq; }, avg_time, count);
+
+  std::cout << "Lambda: " << count.value() << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The counter has no repair function, so the chunks that start from the wrong values are rerun as usual.
+///The parallel runs of some chunks spoil their results, and the sequential runs are slowed down, so that the next
+///chunks start from wrong values
+bool no_function_test()
+{ constexpr size_t ChunkSize = 64;
+  Count_t count(0);
+
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, Count_t& count) {
+    if (!cs.isParExec) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      count_body(i, count.value());
+    }
+    if (cs.isParExec && !(end % ChunkSize) && ((end / ChunkSize) % 4 == 1)) {
+      count.value()++;
+    }
+  };
+
+  count.set(0);
+  SpecLib::specRun(default_config(), 0, N, 1, ChunkSize, loop_f, count);
+  const bool test_ok = (count.value() == CountSeq);
+
+  std::cout << "No function: " << count.value() << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return builtin_repair_test() && lambda_repair_test() && no_function_test() ? 0 : -1;
+}
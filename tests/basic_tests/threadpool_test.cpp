@@ -0,0 +1,158 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     threadpool_test.cpp
+/// \brief    Test on the launches of teams of the thread pool through polling threads and its ring of tickets
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+constexpr size_t RingTickets = 256; ///< Capacity of the ring of tickets of ThreadPool
+
+size_t N = 1000;
+
+/// Launches \c nteams teams of up to \c n threads one after another, and returns whether all the threads launched ran
+bool launch_teams(ThreadPool& pool, const size_t nteams, const size_t n, const bool only_idle = false)
+{ std::atomic<size_t> runs{0};
+  size_t launched = 0;
+  ThreadPool::Team team;
+
+  team.setFunction([&runs] { runs.fetch_add(1); });
+  for (size_t i = 0; i < nteams; i++) {
+    launched += pool.launch(team, n, only_idle);
+    team.wait();
+  }
+  return runs.load() == launched;
+}
+
+/// Several threads launch teams in the same pool at the same time
+bool concurrent_test(const size_t nthreads)
+{ ThreadPool pool(0, 4096, nthreads);
+  std::atomic<bool> ok{true};
+  std::vector<std::thread> launchers;
+
+  for (size_t t = 0; t < 4; t++) {
+    launchers.emplace_back([&] {
+      if (!launch_teams(pool, N, nthreads)) {
+        ok = false;
+      }
+    });
+  }
+  for (auto& th : launchers) {
+    th.join();
+  }
+  const bool test_ok = ok.load();
+
+  std::cout << "Concurrent: " << pool.nthreads() << " threads " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// While all the threads of the pool are busy, launches that only take idle threads get none and create none,
+///and once they are free they get at most the threads of the pool
+bool only_idle_test(const size_t nthreads)
+{ ThreadPool pool(nthreads, 4096, nthreads);
+  std::atomic<bool> release{false};
+  std::atomic<size_t> started{0};
+  ThreadPool::Team busy_team;
+
+  busy_team.setFunction([&] {
+    started.fetch_add(1);
+    while (!release.load()) {
+      std::this_thread::yield();
+    }
+  });
+  const size_t busy = pool.launch(busy_team, nthreads);
+  while (started.load() < busy) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<size_t> runs{0};
+  ThreadPool::Team idle_team;
+  idle_team.setFunction([&runs] { runs.fetch_add(1); });
+  const size_t while_busy = pool.launch(idle_team, nthreads, true);
+  idle_team.wait();
+  const bool busy_ok = (busy == nthreads) && !while_busy && !runs.load() && (pool.nthreads() == nthreads);
+
+  release = true;
+  busy_team.wait();
+  const size_t when_free = pool.launch(idle_team, 2 * nthreads, true);
+  idle_team.wait();
+  const bool free_ok = (when_free <= nthreads) && (runs.load() == when_free) && (pool.nthreads() == nthreads);
+
+  const bool test_ok = busy_ok && free_ok;
+
+  std::cout << "Only idle: " << while_busy << " " << when_free << " " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// The pool is shrunk and grown again while other threads keep launching teams, which must all run
+bool resize_test(const size_t nthreads)
+{ ThreadPool pool(nthreads, 4096, nthreads);
+  std::atomic<bool> ok{true};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> launchers;
+
+  for (size_t t = 0; t < 2; t++) {
+    launchers.emplace_back([&] {
+      if (!launch_teams(pool, N, nthreads)) {
+        ok = false;
+      }
+    });
+  }
+  std::thread resizer([&] {
+    for (size_t i = 0; !done.load(); i++) {
+      pool.resize((i & 1) ? nthreads : 0);
+    }
+  });
+  for (auto& th : launchers) {
+    th.join();
+  }
+  done = true;
+  resizer.join();
+
+  // no team is running now, so all the threads can be terminated once the last ones become idle
+  for (size_t tries = 0; pool.nthreads() && (tries < 1000); tries++) {
+    pool.resize(0);
+    std::this_thread::yield();
+  }
+  const bool test_ok = ok.load() && !pool.nthreads() && launch_teams(pool, 10, nthreads);
+
+  std::cout << "Resize: " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Teams launched back to back find the threads of the previous ones polling, so they are handed tickets,
+///many more than the capacity of the ring
+bool ring_test(const size_t nthreads)
+{ ThreadPool pool(0, 1 << 20, nthreads);
+
+  const bool test_ok = launch_teams(pool, 8 * RingTickets, nthreads) && (pool.nthreads() <= nthreads);
+
+  std::cout << "Ring: " << pool.nthreads() << " threads " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  const size_t nthreads = std::max(NThreads, static_cast<size_t>(2));
+  return concurrent_test(nthreads) && only_idle_test(nthreads) && resize_test(nthreads) && ring_test(nthreads) ? 0 : -1;
+}
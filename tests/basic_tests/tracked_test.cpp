@@ -0,0 +1,134 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     tracked_test.cpp
+/// \brief    Test on support of SpecTrackedVector
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <random>
+#include <functional>
+#include <limits>
+#include <vector>
+
+constexpr int RAND_SEED = 981;
+constexpr size_t NBUCKETS = 4096;
+
+size_t N = 1000;
+std::vector<int> MaxSeq(NBUCKETS);
+int *Vals;
+
+/// Maximum of the values that fall in each bucket, so that every iteration writes a single element
+static inline void body(const size_t iteration, SpecLib::SpecTrackedVector<int>& max_vals)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  const size_t bucket = static_cast<size_t>(Vals[iteration]) % NBUCKETS;
+  if (Vals[iteration] > max_vals.get(bucket)) {
+    max_vals[bucket] = Vals[iteration];
+  }
+}
+
+void seq_test()
+{ std::vector<int> max_seq(NBUCKETS, 0);
+
+  auto tseq_begin = profile_clock_t::now();
+  for (size_t i = 0; i < N; i++) {
+    const size_t bucket = static_cast<size_t>(Vals[i]) % NBUCKETS;
+    if (Vals[i] > max_seq[bucket]) {
+      max_seq[bucket] = Vals[i];
+    }
+  }
+  auto tseq_end = profile_clock_t::now();
+
+  MaxSeq = max_seq;
+
+  std::cout << "Seq   : " << *std::max_element(max_seq.begin(), max_seq.end()) << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+SpecLib::SpecTrackedVector<int> max_spec(NBUCKETS, 0);
+double avg_time;
+
+const auto reset_result = [] () { max_spec = SpecLib::SpecTrackedVector<int>(NBUCKETS, 0); };
+const auto test_f = [] () { return (max_spec.values() == MaxSeq); };
+
+bool lambda_test()
+{
+  const auto loop_f = [&](const size_t iteration, SpecLib::SpecTrackedVector<int>& max_vals) {
+    body(iteration, max_vals);
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, max_spec);
+
+  std::cout << "Lambda: " << *std::max_element(max_spec.values().begin(), max_spec.values().end()) << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool lambda_loop_test()
+{
+  const auto loop_f = [&](const SpecLib::ExCommonSpecInfo_t& cs, const size_t begin, const size_t end, const size_t step, SpecLib::SpecTrackedVector<int>& max_vals) {
+    for (size_t i = begin; (i < end) && !cs.cancelled(); i+=step) {
+      body(i, max_vals);
+    }
+  };
+
+  const bool test_ok = bench(0, N, 1, loop_f, reset_result, test_f, avg_time, max_spec);
+
+  std::cout << "Lambda loop: " << *std::max_element(max_spec.values().begin(), max_spec.values().end()) << " " << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+/// Copies and comparisons after writes in a few blocks
+bool tracking_test()
+{
+  SpecLib::SpecTrackedVector<int> a(std::vector<int>(1000, 1));
+  SpecLib::SpecTrackedVector<int> b(a);
+  bool test_ok = (a == b) && (SpecLib::SpecTrackedVector<int>(1000, 1) != SpecLib::SpecTrackedVector<int>(1000, 2));
+
+  a[10] = 5;
+  b[990] = 7;
+  test_ok = test_ok && (a != b);
+  b = a;
+  test_ok = test_ok && (a == b) && (b.get(10) == 5) && (b.get(990) == 1);
+  a[10] = 1;   // the copy does not see the writes after it
+  test_ok = test_ok && (a != b) && (b.get(10) == 5);
+  b[10] = 1;
+  test_ok = test_ok && (a == b);
+
+  std::cout << "Tracking: " << (test_ok ? 'Y' : 'N') << std::endl << std::endl;
+
+  return test_ok;
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return tracking_test() && lambda_test() && lambda_loop_test() ? 0 : -1;
+}
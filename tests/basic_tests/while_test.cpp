@@ -0,0 +1,174 @@
+/*
+ SpecLib: Library for speculative execution of loops
+ Copyright (C) 2023 Millan A. Martinez, Basilio B. Fraguela, Jose C. Cabaleiro, Francisco F. Rivera. Universidade da Coruna
+
+ Distributed under the MIT License. (See accompanying file LICENSE)
+*/
+
+///
+/// \file     while_test.cpp
+/// \brief    Test on loops whose number of iterations is not known in advance
+/// \author   Millan A. Martinez  <millan.alvarez@udc.es>
+/// \author   Basilio B. Fraguela <basilio.fraguela@udc.es>
+/// \author   Jose C. Cabaleiro   <jc.cabaleiro@usc.es>
+/// \author   Francisco F. Rivera <ff.rivera@usc.es>
+///
+
+#include "speclib/speclib.h"
+#include "../common_files/common_test.cpp"
+#include <cmath>
+#include <random>
+#include <functional>
+#include <limits>
+
+constexpr int RAND_SEED = 981;
+
+size_t N = 1000;
+int *Vals;
+
+/// Results of the sequential versions of the loops
+int MaxSeq;
+long FoundSeq;
+int MaxRevSeq;
+long FoundRevSeq;
+double RootSeq;
+long StepsSeq;
+
+/// Search loop that stops at the first negative value or the end of the vector
+static inline bool search_body(const long iteration, long& found, int& max)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (Vals[iteration] < 0) {
+    found = iteration;
+    return false;
+  }
+  if (Vals[iteration] > max) {
+    max = Vals[iteration];
+  }
+  return (iteration + 1) < static_cast<long>(N);
+}
+
+/// Search loop in reverse order that stops at the last negative value or the beginning of the vector
+static inline bool search_rev_body(const long iteration, long& found, int& max)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  if (Vals[iteration] < 0) {
+    found = iteration;
+    return false;
+  }
+  if (Vals[iteration] > max) {
+    max = Vals[iteration];
+  }
+  return iteration > 0;
+}
+
+/// Fixed point iteration of cos(x), which runs until it converges
+static inline bool converge_body(const long iteration, double& x, long& steps)
+{
+#ifdef ENABLE_DELAY
+  mywait(DelaySeconds);
+#endif
+  const double next = std::cos(x);
+  const bool converged = std::fabs(next - x) < 1e-12;
+  x = next;
+  steps = iteration + 1;
+  return !converged;
+}
+
+void seq_test()
+{ int max_seq = 0, max_rev_seq = 0;
+  long found_seq = -1, found_rev_seq = -1, steps_seq = 0;
+  double root_seq = 0.0;
+
+  auto tseq_begin = profile_clock_t::now();
+  for (long i = 0; search_body(i, found_seq, max_seq); i++);
+  for (long i = static_cast<long>(N) - 1; search_rev_body(i, found_rev_seq, max_rev_seq); i--);
+  for (long i = 0; converge_body(i, root_seq, steps_seq); i++);
+  auto tseq_end = profile_clock_t::now();
+
+  MaxSeq = max_seq;
+  FoundSeq = found_seq;
+  MaxRevSeq = max_rev_seq;
+  FoundRevSeq = found_rev_seq;
+  RootSeq = root_seq;
+  StepsSeq = steps_seq;
+
+  std::cout << "Seq   : " << found_seq << " " << max_seq << " " << found_rev_seq << " " << max_rev_seq << " " << root_seq << " " << steps_seq << std::endl;
+  std::cout << "Time  : " << std::chrono::duration<double>(tseq_end - tseq_begin).count() << std::endl << std::endl;
+}
+
+/// Runs \c run_f, which launches a loop and returns whether its result is correct, NReps times
+template<typename FRun>
+bool run_test(const char * const name, const FRun& run_f)
+{ bool test_ok = true;
+  double avg_time = 0.0;
+  size_t i;
+
+  for (i = 0; (i < NReps) && test_ok; i++) {
+    const auto tpar_begin = profile_clock_t::now();
+    test_ok = run_f();
+    const auto tpar_end = profile_clock_t::now();
+    avg_time += std::chrono::duration<double>(tpar_end - tpar_begin).count();
+  }
+  avg_time /= static_cast<double>(i);
+  std::cout << name << (test_ok ? 'Y' : 'N') << std::endl;
+  std::cout << "Time  : " << avg_time << std::endl << std::endl;
+
+  return test_ok;
+}
+
+bool search_test()
+{
+  return run_test("Search: ", [] () {
+    long found = -1;
+    int max = 0;
+    SpecLib::specWhile(default_config(), 0L, 1L, SpecLib::getChunkSize(N, NChunks), search_body, found, max);
+    return (found == FoundSeq) && (max == MaxSeq);
+  });
+}
+
+bool search_rev_test()
+{
+  return run_test("Reverse search: ", [] () {
+    long found = -1;
+    int max = 0;
+    SpecLib::specWhile(default_config(), static_cast<long>(N) - 1, -1L, SpecLib::getChunkSize(N, NChunks), search_rev_body, found, max);
+    return (found == FoundRevSeq) && (max == MaxRevSeq);
+  });
+}
+
+/// Loop with a true dependence in every iteration
+bool converge_test()
+{
+  return run_test("Converge: ", [] () {
+    double x = 0.0;
+    long steps = 0;
+    SpecLib::specWhile(default_config(), 0L, 1L, 16, [](const long iteration, double& res, long& res_steps) {
+      return converge_body(iteration, res, res_steps);
+    }, x, steps);
+    return (x == RootSeq) && (steps == StepsSeq);
+  });
+}
+
+int main(int argc, char **argv)
+{
+  process_args(argc, argv, "hc:d:m:N:n:t:s:v", N);
+
+  Vals = new int[N];
+  auto mt_rand_gen = std::bind(std::uniform_int_distribution<int>(0, std::numeric_limits<int>::max()), std::mt19937(static_cast<std::mt19937::result_type>(static_cast<int>(RAND_SEED))));
+  for (size_t i = 0; i < N; i++) {
+    Vals[i] = mt_rand_gen();
+  }
+  Vals[(3 * N) / 4] = -1;
+  Vals[N / 4] = -2;
+
+  seq_test();
+
+  do_preheat(); // Preheat
+
+  return search_test() && search_rev_test() && converge_test() ? 0 : -1;
+}
@@ -308,6 +308,9 @@ void printStatsRunInfo(const SpecLib::StatsRunInfo& statsRes, const int n = -1)
     std::cout << "failures:   " << std::setw(fieldWidth) << std::right << statsRes.failures << "\t(" << std::setw(percWidht) << std::right << std::fixed << std::setprecision(2) << static_cast<double>(statsRes.failures)*100.0/static_cast<double>(statsRes.total) << "%)" << std::endl;
     std::cout << "sequential: " << std::setw(fieldWidth) << std::right << statsRes.sequential << "\t(" << std::setw(percWidht) << std::right << std::fixed << std::setprecision(2) << static_cast<double>(statsRes.sequential)*100.0/static_cast<double>(statsRes.total) << "%)" << std::endl;
     std::cout << "TOTAL:      " << std::setw(fieldWidth) << std::right << statsRes.total << std::endl;
+    if (statsRes.salvaged > 0) {
+      std::cout << "salvaged:   " << std::setw(fieldWidth) << std::right << statsRes.salvaged << std::endl;
+    }
   } else {
     std::cout << "successes:  " << std::setw(1) << std::right << statsRes.successes << std::endl;
     std::cout << "failures:   " << std::setw(1) << std::right << statsRes.failures << std::endl;
@@ -323,8 +326,17 @@ void printStatsRunInfo(const SpecLib::StatsRunInfo& statsRes, const int n = -1)
 }
 #endif
 
+SpecLib::Configuration default_config()
+{
+#ifdef SLSIMULATE
+  return SpecLib::Configuration(NThreads, MinParalThreads, SimulatedSuccessRatio);
+#else
+  return SpecLib::Configuration(NThreads, MinParalThreads);
+#endif
+}
+
 template<typename Ti, typename FRun, typename FReset, typename FTest, typename... ArgT>
-bool bench(const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, const FRun& f_run, const FReset& f_reset, const FTest& f_test, double& avg_time , ArgT&&... args)
+bool bench(const SpecLib::Configuration& config, const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, const FRun& f_run, const FReset& f_reset, const FTest& f_test, double& avg_time , ArgT&&... args)
 { size_t i;
   bool test_ok = true;
   const size_t calcChunk = SpecLib::getChunkSize(static_cast<size_t>((step >= 0) ? ((end - begin + step - 1) / step) : ((end - begin + step + 1) / step)), NChunks);
@@ -337,17 +349,9 @@ bool bench(const typename std::remove_reference<Ti>::type begin, const Ti end, c
     auto tpar_begin = profile_clock_t::now();
 
 #if !defined(SLSTATS) && !defined(SLMINIMALSTATS)
-#ifdef SLSIMULATE
-    SpecLib::specRun({NThreads, MinParalThreads, SimulatedSuccessRatio}, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
+    SpecLib::specRun(config, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
 #else
-    SpecLib::specRun({NThreads, MinParalThreads}, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
-#endif
-#else
-#ifdef SLSIMULATE
-    SpecLib::StatsRunInfo tmpStatsRes = SpecLib::specRun({NThreads, MinParalThreads, SimulatedSuccessRatio}, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
-#else
-    SpecLib::StatsRunInfo tmpStatsRes = SpecLib::specRun({NThreads, MinParalThreads}, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
-#endif
+    SpecLib::StatsRunInfo tmpStatsRes = SpecLib::specRun(config, begin, end, step, calcChunk, f_run, std::forward<ArgT>(args)...);
     statsRes += tmpStatsRes;
 #endif
 
@@ -366,4 +370,10 @@ bool bench(const typename std::remove_reference<Ti>::type begin, const Ti end, c
   return test_ok;
 
 }
+
+template<typename Ti, typename FRun, typename FReset, typename FTest, typename... ArgT>
+bool bench(const typename std::remove_reference<Ti>::type begin, const Ti end, const typename std::remove_reference<Ti>::type step, const FRun& f_run, const FReset& f_reset, const FTest& f_test, double& avg_time , ArgT&&... args)
+{
+  return bench(default_config(), begin, end, step, f_run, f_reset, f_test, avg_time, std::forward<ArgT>(args)...);
+}
 #endif